@@ -1,17 +1,52 @@
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <new>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <shared_mutex>
 #include <span>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <iostream>
 #include <string>
 
-/*!
- * Implementation of dynamic "Struct Of Arrays" vector with a single memory allocation.
- */
-template <typename... Types>
-class SOAVector
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace detail
 {
     /*!
      * Helper struct to map template argument index to the corresponding type.
@@ -24,238 +59,374 @@ class SOAVector
 
     template <typename T, typename... Ts>
     struct IndexToType<0, T, Ts...> { T value; };
-public:
+
     /*!
-     * The value type of the N'th template argument.
+     * The size of a cache line in bytes, used to align arrays so that rows
+     * can be partitioned without false sharing.
      */
-    template <std::size_t i>
-    using value_type = decltype(IndexToType<i, Types...>::value);
+    inline constexpr std::size_t cache_line_size = 64;
 
-    using size_type = std::size_t;
+    /*!
+     * Get the smallest number of rows for which every array of the given
+     * types spans a whole number of cache lines.
+     */
+    template <typename... Types>
+    constexpr std::size_t rows_per_cache_line()
+    {
+        std::size_t rows = 1;
+        ((rows = std::lcm(rows, cache_line_size / std::gcd(sizeof(Types), cache_line_size))), ...);
+        return rows;
+    }
+}
 
+/*!
+ * Column type for strings stored in an arena.
+ *
+ * A 'SOAVector' array of 'ArenaString' holds the end offset of each string
+ * in one contiguous character buffer per column, like an Arrow string
+ * array. Strings are added as 'std::string_view' and read back as
+ * 'std::string_view', scanning them reads memory sequentially, and
+ * reallocating the vector copies the offsets without touching the
+ * characters.
+ */
+struct ArenaString
+{
     /*!
-     * Default constructor.
-     *
-     * Creates an empty SOA vector.
+     * The offset one past the last character of the string. The string
+     * starts at the end of the previous one.
      */
-    SOAVector() = default;
+    std::uint64_t end = 0;
+};
 
+/*!
+ * Column type for flags packed into a bitset.
+ *
+ * A 'SOAVector' array of 'PackedBool' holds 64 rows per element: bit
+ * i % 64 of element i / 64 is the flag of row i, and the bits past the last
+ * row are always zero. 'get()' returns a 'PackedBool::reference' to a single
+ * flag, while 'data()' and 'span()' expose the words for kernels such as
+ * 'mask_count()' that process 64 rows per operation.
+ */
+struct PackedBool
+{
     /*!
-     * Create a SOA vector with a given size, default initializing all elements.
-     *
-     * @param size The number of elements.
+     * The number of rows per word.
      */
-    SOAVector(size_type size)
+    static constexpr std::size_t bits = 64;
+
+    /*!
+     * Proxy reference to a single flag of a packed array.
+     */
+    class reference
     {
-        this->reserve(size);
-        size_ = size;
+    public:
+        /*!
+         * Create a reference to a bit of a word.
+         *
+         * @param word The word.
+         * @param bit The index of the bit in the word.
+         */
+        reference(std::uint64_t & word, std::size_t bit) noexcept:
+            word_(&word),
+            mask_(std::uint64_t(1) << bit)
+        {
+        }
 
-        if (size_ > 0)
+        reference(reference const & other) noexcept = default;
+
+        /*!
+         * Set the flag.
+         */
+        reference & operator=(bool value) noexcept
         {
-            std::size_t type_index = 0;
-            (
-                (
-                    create_default_elements<Types>(
-                        array_ptrs_[type_index],
-                        array_ptrs_[type_index] + size_ * sizeof(Types)),
-                    ++type_index
-                ),
-                ...
-            );
+            *word_ = value ? (*word_ | mask_) : (*word_ & ~mask_);
+            return *this;
         }
-    }
+
+        /*!
+         * Set the flag to the value of another one.
+         */
+        reference & operator=(reference const & other) noexcept
+        {
+            return *this = static_cast<bool>(other);
+        }
+
+        /*!
+         * Get the flag.
+         */
+        operator bool() const noexcept
+        {
+            return (*word_ & mask_) != 0;
+        }
+
+        /*!
+         * Invert the flag.
+         */
+        void flip() noexcept
+        {
+            *word_ ^= mask_;
+        }
+
+    private:
+        // Member variables:
+        std::uint64_t * word_;
+        std::uint64_t mask_;
+    };
 
     /*!
-     * Copy constructor.
+     * Get the number of words holding a number of rows.
      */
-    SOAVector(SOAVector const & other)
+    static constexpr std::size_t word_count(std::size_t rows) noexcept
     {
-        this->reserve(other.size());
+        return (rows + bits - 1) / bits;
+    }
 
-        if (other.size() > 0)
+    /*!
+     * The flags of 64 rows.
+     */
+    std::uint64_t word = 0;
+};
+
+/*!
+ * Column type for values that may be missing.
+ *
+ * A 'SOAVector' array of 'Nullable<T>' holds the values followed by a
+ * validity bitmap in the same memory allocation, like an Arrow array: bit
+ * i % 64 of word i / 64 is set if row i holds a value. Null rows hold a
+ * default constructed value. Rows are added and read as 'std::optional<T>';
+ * 'span()' exposes the values and 'validity()' the bitmap, for kernels such
+ * as 'nullable_sum()' that process 64 rows per word.
+ */
+template <typename T>
+struct Nullable
+{
+    using value_type = T;
+
+    /*!
+     * The value, or a default constructed one for a null row.
+     */
+    T value = T();
+};
+
+namespace detail
+{
+    template <typename T>
+    inline constexpr bool is_nullable_column = false;
+
+    template <typename T>
+    inline constexpr bool is_nullable_column<Nullable<T>> = true;
+
+    /*!
+     * Whether a column type is stored as plain elements in its array, so
+     * code that copies or persists arrays element by element supports it.
+     */
+    template <typename T>
+    inline constexpr bool is_plain_column =
+        !std::is_same_v<T, ArenaString> && !std::is_same_v<T, PackedBool> && !is_nullable_column<T>;
+
+    /*!
+     * Get the number of bytes of an array holding a number of rows.
+     */
+    template <typename T>
+    constexpr std::size_t array_bytes(std::size_t rows) noexcept
+    {
+        if constexpr (std::is_same_v<T, PackedBool>)
         {
-            std::size_t type_index = 0;
-            (
-                (
-                    copy_elements<Types>(
-                        other.array_ptrs_[type_index],
-                        other.array_ptrs_[type_index] + other.size_ * sizeof(Types),
-                        this->array_ptrs_[type_index]),
-                    ++type_index
-                ),
-                ...
-            );
+            return PackedBool::word_count(rows) * sizeof(PackedBool);
+        }
+        else
+        {
+            return rows * sizeof(T);
         }
-        size_ = other.size_;
     }
 
     /*!
-     * Move constructor.
+     * Get the offset of the validity bitmap of a 'Nullable' array from the
+     * start of the array, which is right after the values.
      */
-    SOAVector(SOAVector && other):
-        array_ptrs_(other.array_ptrs_),
-        size_(other.size_),
-        capacity_(other.capacity_)
+    template <typename T>
+    constexpr std::size_t validity_offset(std::size_t capacity) noexcept
     {
-        std::fill(other.array_ptrs_.begin(), other.array_ptrs_.end(), nullptr);
-        other.size_ = 0;
-        other.capacity_ = 0;
+        return (capacity * sizeof(T) + alignof(PackedBool) - 1) / alignof(PackedBool) * alignof(PackedBool);
     }
 
     /*!
-     * Destructor.
+     * Get the number of bytes to allocate for an array with a capacity,
+     * including the validity bitmap of a 'Nullable' array.
      */
-    ~SOAVector()
+    template <typename T>
+    constexpr std::size_t allocation_bytes(std::size_t capacity) noexcept
     {
-        if (capacity_ == 0)
+        if constexpr (is_nullable_column<T>)
         {
-            return;
+            return validity_offset<T>(capacity) + PackedBool::word_count(capacity) * sizeof(PackedBool);
         }
-        if (size_ > 0)
+        else
         {
-            std::size_t type_index = 0;
-            (
-                (
-                    delete_elements<Types>(
-                        array_ptrs_[type_index],
-                        array_ptrs_[type_index] + size_ * sizeof(Types)),
-                    ++type_index
-                ),
-                ...
-            );
+            return array_bytes<T>(capacity);
         }
-        delete[] array_ptrs_[0];
     }
 
     /*!
-     * Copy assignment operator.
+     * The parameter type for adding an element to a column with
+     * 'SOAVector::push_back()'.
      */
-    SOAVector<Types...> & operator=(SOAVector<Types...> const & other)
+    template <typename T>
+    struct ColumnArgument
     {
-        if (&other == this)
-        {
-            // Avoid self assignment.
-            return *this;
-        }
+        using type = T &&;
+    };
 
-        this->clear();
-        this->reserve(other.size());
+    template <>
+    struct ColumnArgument<ArenaString>
+    {
+        using type = std::string_view;
+    };
 
-        if (other.size() > 0)
-        {
-            std::size_t type_index = 0;
-            (
-                (
-                    copy_elements<Types>(
-                        other.array_ptrs_[type_index],
-                        other.array_ptrs_[type_index] + other.size_ * sizeof(Types),
-                        this->array_ptrs_[type_index]),
-                    ++type_index
-                ),
-                ...
-            );
-        }
-        size_ = other.size_;
+    template <>
+    struct ColumnArgument<PackedBool>
+    {
+        using type = bool;
+    };
 
-        return *this;
-    }
+    template <typename T>
+    struct ColumnArgument<Nullable<T>>
+    {
+        using type = std::optional<T>;
+    };
 
     /*!
-     * Move assignment operator.
+     * A column type supported by the containers built on plain arrays. They
+     * copy, publish or store elements one by one, so 'ArenaString',
+     * 'PackedBool' and 'Nullable' columns are only supported by 'SOAVector'.
      */
-    SOAVector<Types...> & operator=(SOAVector<Types...> && other)
-    {
-        if (&other == this)
-        {
-            // Avoid self assignment.
-            return *this;
-        }
+    template <typename T>
+    concept PlainColumn = is_plain_column<T>;
+}
 
-        this->clear();
+template <typename... Types>
+class SOAVector;
 
-        if (capacity_ > 0)
-        {
-            delete[] array_ptrs_[0];
-        }
+/*!
+ * Non-owning view over a range of rows in a set of arrays.
+ *
+ * A span does not own the arrays it refers to and is only valid as long as
+ * the underlying memory is. The arrays may belong to a 'SOAVector' or be any
+ * caller-provided memory, e.g. memory mapped files or network buffers, so
+ * code written against 'SOASpan' works on both without copying. Use
+ * 'SOASpan<Types const...>' for a read-only view.
+ */
+template <typename... Types>
+class SOASpan
+{
+    template <typename... Ts>
+    friend class SOASpan;
+public:
+    /*!
+     * The value type of the N'th template argument.
+     */
+    template <std::size_t i>
+    using value_type = decltype(detail::IndexToType<i, Types...>::value);
 
-        array_ptrs_ = other.array_ptrs_;
-        size_ = other.size_;
-        capacity_ = other.capacity_;
+    using size_type = std::size_t;
 
-        std::fill(other.array_ptrs_.begin(), other.array_ptrs_.end(), nullptr);
-        other.size_ = 0;
-        other.capacity_ = 0;
+    /*!
+     * Default constructor.
+     *
+     * Creates an empty span.
+     */
+    SOASpan() = default;
 
-        return *this;
-    }
+    /*!
+     * Create a span over caller-provided arrays.
+     *
+     * @param size The number of rows, i.e. elements in each array.
+     * @param ptrs The pointers to the first element of each array.
+     */
+    SOASpan(size_type size, Types *... ptrs) noexcept:
+        array_ptrs_(ptrs...),
+        size_(size)
+    {}
 
     /*!
-     * Get whether the vector is empty.
+     * Create a span over caller-provided arrays of equal size.
      *
-     * @return True if the vector is empty, otherwise false.
+     * @param arrays The arrays.
      */
-    bool empty() const noexcept
+    explicit SOASpan(std::span<Types>... arrays) noexcept:
+        array_ptrs_(arrays.data()...),
+        size_(std::get<0>(std::tuple(arrays.size()...)))
     {
-        return this->size_ > 0;
+        assert(((arrays.size() == size_) && ...));
     }
 
     /*!
-     * Get the size, i.e. number of elements in the vector.
+     * Create a read-only span from a mutable one.
      *
-     * @return The number of elements.
+     * @param other The span to convert.
      */
-    size_type size() const noexcept
-    {
-        return this->size_;
-    }
+    template <typename... OtherTypes>
+        requires (!std::is_same_v<SOASpan<OtherTypes...>, SOASpan>
+            && (std::is_convertible_v<OtherTypes (*)[], Types (*)[]> && ...))
+    SOASpan(SOASpan<OtherTypes...> const & other) noexcept:
+        array_ptrs_(std::apply(
+            [](OtherTypes *... ptrs) { return std::tuple<Types *...>(ptrs...); },
+            other.array_ptrs_)),
+        size_(other.size_)
+    {}
 
     /*!
-     * Get the capacity, i.e. the number of elements the current memory
-     * allocation can fit.
+     * Create a span over all rows of a SOA vector.
      *
-     * @return The capacity.
+     * @param vec The vector. The span is invalidated when it reallocates.
      */
-    size_type capacity() const noexcept
-    {
-        return capacity_;
-    }
+    template <typename... VectorTypes>
+        requires (std::is_convertible_v<VectorTypes (*)[], Types (*)[]> && ...)
+    SOASpan(SOAVector<VectorTypes...> & vec) noexcept:
+        SOASpan(vec.slice(0, vec.size()))
+    {}
 
     /*!
-     * Get the pointer to the first element of an array.
+     * Create a read-only span over all rows of a SOA vector.
      *
-     * @tparam TypeIndex The index of the array to get the pointer of.
-     * @return The pointer to the first element in the array.
+     * @param vec The vector. The span is invalidated when it reallocates.
      */
-    template<size_type TypeIndex>
-    value_type<TypeIndex> * data() noexcept
+    template <typename... VectorTypes>
+        requires (std::is_convertible_v<VectorTypes const (*)[], Types (*)[]> && ...)
+    SOASpan(SOAVector<VectorTypes...> const & vec) noexcept:
+        SOASpan(vec.slice(0, vec.size()))
+    {}
+
+    /*!
+     * Get whether the span is empty.
+     *
+     * @return True if the span is empty, otherwise false.
+     */
+    bool empty() const noexcept
     {
-        return reinterpret_cast<value_type<TypeIndex> *>(array_ptrs_[TypeIndex]);
+        return this->size_ == 0;
     }
 
     /*!
-     * Get the pointer to the first element of an array.
+     * Get the size, i.e. number of rows in the span.
      *
-     * @tparam TypeIndex The index of the array to get the pointer of.
-     * @return The pointer to the first element in the array.
+     * @return The number of rows.
      */
-    template<size_type TypeIndex>
-    value_type<TypeIndex> const * data() const noexcept
+    size_type size() const noexcept
     {
-        return reinterpret_cast<value_type<TypeIndex> const *>(array_ptrs_[TypeIndex]);
+        return this->size_;
     }
 
     /*!
-     * Get a reference to the element of a certain array at a given index.
+     * Get the pointer to the first element of an array.
      *
-     * @tparam TypeIndex The index of the array.
-     * @param index The index.
-     * @return A reference to the element at the position.
+     * @tparam TypeIndex The index of the array to get the pointer of.
+     * @return The pointer to the first element in the array.
      */
     template<size_type TypeIndex>
-    value_type<TypeIndex> & get(size_type index) noexcept
+    value_type<TypeIndex> * data() const noexcept
     {
-        assert(index < size_);
-        return *(this->data<TypeIndex>() + index);
+        return std::get<TypeIndex>(array_ptrs_);
     }
 
     /*!
@@ -266,7 +437,7 @@ public:
      * @return A reference to the element at the position.
      */
     template<size_type TypeIndex>
-    value_type<TypeIndex> const & get(size_type index) const noexcept
+    value_type<TypeIndex> & get(size_type index) const noexcept
     {
         assert(index < size_);
         return *(this->data<TypeIndex>() + index);
@@ -279,342 +450,9717 @@ public:
      * @return A reference to the first element in the array.
      */
     template<size_type TypeIndex>
-    value_type<TypeIndex> & front() noexcept
+    value_type<TypeIndex> & front() const noexcept
     {
         return this->get<TypeIndex>(0);
     }
 
     /*!
-     * Get a reference to the first element of a certain array.
+     * Get a reference to the last element of a certain array.
      *
      * @tparam TypeIndex The index of the array.
-     * @return A reference to the first element in the array.
+     * @return A reference to the last element in the array.
      */
     template<size_type TypeIndex>
-    value_type<TypeIndex> const & front() const noexcept
+    value_type<TypeIndex> & back() const noexcept
     {
-        return this->get<TypeIndex>(0);
+        return this->get<TypeIndex>(this->size_ - 1);
     }
 
     /*!
-     * Get a reference to the last element of a certain array.
+     * Get a span over the elements in a certain array.
      *
      * @tparam TypeIndex The index of the array.
-     * @return A reference to the last element in the array.
+     * @return A span over the elements in the array.
      */
     template<size_type TypeIndex>
-    value_type<TypeIndex> & back() noexcept
+    std::span<value_type<TypeIndex>> span() const noexcept
     {
-        return this->get<TypeIndex>(this->size_ - 1);
+        return std::span<value_type<TypeIndex>>(this->data<TypeIndex>(), this->size_);
     }
 
     /*!
-     * Get a reference to the last element of a certain array.
+     * Get a view over a range of rows of this span.
      *
-     * @tparam TypeIndex The index of the array.
-     * @return A reference to the last element in the array.
+     * @param first The index of the first row in the view.
+     * @param count The number of rows in the view.
+     * @return A span over the rows [first, first + count).
      */
-    template<size_type TypeIndex>
-    value_type<TypeIndex> const & back() const noexcept
+    SOASpan slice(size_type first, size_type count) const noexcept
     {
-        return this->get<TypeIndex>(this->size_ - 1);
+        assert(first <= size_ && count <= size_ - first);
+        return SOASpan(
+            count,
+            std::apply(
+                [first](Types *... ptrs) { return std::tuple<Types *...>((ptrs + first)...); },
+                array_ptrs_));
     }
 
     /*!
-     * Get a span over the elements in a certain array.
+     * Split the span into a number of roughly equal, disjoint slices.
      *
-     * @tparam TypeIndex The index of the array.
-     * @return A span over the elements in the array.
+     * The boundaries between slices are placed on multiples of
+     * 'detail::rows_per_cache_line()', so that no two slices share a cache
+     * line in any array as long as the span itself starts on one. This
+     * makes the slices suitable for handing out to different threads.
+     *
+     * @param count The number of slices. Some slices may be empty if there
+     *      are fewer cache lines than slices.
+     * @return The slices, in order, covering all rows of the span.
+     */
+    std::vector<SOASpan> split(size_type count) const
+    {
+        assert(count > 0);
+        constexpr size_type granularity = detail::rows_per_cache_line<Types...>();
+
+        std::vector<SOASpan> slices;
+        slices.reserve(count);
+        size_type first = 0;
+        for (size_type i = 1; i <= count; ++i)
+        {
+            size_type last = size_;
+            if (i < count)
+            {
+                last = size_ / count * i + size_ % count * i / count;
+                last = std::max(first, last / granularity * granularity);
+            }
+            slices.push_back(this->slice(first, last - first));
+            first = last;
+        }
+        return slices;
+    }
+
+private:
+    /*!
+     * Create a span from a set of array pointers and a size.
+     */
+    SOASpan(size_type size, std::tuple<Types *...> array_ptrs) noexcept:
+        array_ptrs_(array_ptrs),
+        size_(size)
+    {}
+
+    // Member variables:
+    std::tuple<Types *...> array_ptrs_{};
+    size_type size_ = 0;
+};
+
+/*!
+ * Implementation of dynamic "Struct Of Arrays" vector with a single memory allocation.
+ *
+ * Every array starts on a cache line boundary, so that slices created by
+ * 'split()' can be processed by different threads without false sharing.
+ *
+ * Arrays of 'ArenaString' keep their characters in a separate buffer per
+ * column; 'get()' returns them as 'std::string_view', while 'data()',
+ * 'span()' and views expose the end offsets. Arrays of 'PackedBool' hold a
+ * bitset; 'get()' returns a proxy reference and 'span()' the words. Arrays
+ * of 'Nullable<T>' are followed by a validity bitmap; 'get()' returns a
+ * 'std::optional<T>'. Views cannot address rows of packed arrays, nor the
+ * validity of nullable ones.
+ */
+template <typename... Types>
+class SOAVector
+{
+    /*!
+     * Whether any array is an 'ArenaString' column.
+     */
+    static constexpr bool has_arena_columns = (std::is_same_v<Types, ArenaString> || ...);
+
+public:
+    /*!
+     * The value type of the N'th template argument.
+     */
+    template <std::size_t i>
+    using value_type = decltype(detail::IndexToType<i, Types...>::value);
+
+    using size_type = std::size_t;
+
+    /*!
+     * The alignment of the memory allocation.
+     */
+    static constexpr std::size_t allocation_alignment = std::max({detail::cache_line_size, alignof(Types)...});
+
+    /*!
+     * A memory allocation holding the arrays of a SOA vector.
+     *
+     * Used to hand a memory allocation over to or from a SOA vector without
+     * copying the elements.
+     */
+    struct Storage
+    {
+        /*!
+         * The start of the memory allocation, aligned to 'allocation_alignment'.
+         */
+        char * data = nullptr;
+
+        /*!
+         * The byte offset of each array from 'data', as given by
+         * 'calculate_array_offsets_and_allocation_size(capacity)'.
+         */
+        std::array<ptrdiff_t, sizeof...(Types)> offsets{};
+
+        /*!
+         * The number of constructed elements in each array.
+         */
+        size_type size = 0;
+
+        /*!
+         * The number of elements each array has room for.
+         */
+        size_type capacity = 0;
+
+        /*!
+         * The function freeing 'data'. Elements are destroyed before it is called.
+         */
+        std::function<void(char *)> deleter;
+    };
+
+    /*!
+     * Default constructor.
+     *
+     * Creates an empty SOA vector.
+     */
+    SOAVector() = default;
+
+    /*!
+     * Create a SOA vector adopting an existing memory allocation.
+     *
+     * The allocation must be laid out as given by
+     * 'calculate_array_offsets_and_allocation_size(storage.capacity)' and the
+     * first 'storage.size' elements of each array must be constructed. The
+     * vector destroys the elements and calls 'storage.deleter' to free the
+     * allocation when it is done with it, e.g. when reallocating.
+     *
+     * @param storage The memory allocation to adopt.
+     */
+    explicit SOAVector(Storage && storage):
+        size_(storage.size),
+        capacity_(storage.capacity),
+        deleter_(std::move(storage.deleter))
+    {
+        static_assert(!has_arena_columns, "The characters of ArenaString columns are not part of the allocation");
+        assert(storage.size <= storage.capacity);
+        assert(storage.capacity > 0);
+        assert(storage.offsets == calculate_array_offsets_and_allocation_size(storage.capacity).first);
+        assert(reinterpret_cast<std::uintptr_t>(storage.data) % allocation_alignment == 0);
+
+        for (std::size_t array_index = 0; array_index < array_ptrs_.size(); ++array_index)
+        {
+            array_ptrs_[array_index] = storage.data + storage.offsets[array_index];
+        }
+        storage = Storage{};
+    }
+
+    /*!
+     * Create a SOA vector with a given size, default initializing all elements.
+     *
+     * @param size The number of elements.
+     */
+    SOAVector(size_type size)
+    {
+        this->reserve(size);
+        size_ = size;
+
+        if (size_ > 0)
+        {
+            std::size_t type_index = 0;
+            (
+                (
+                    create_default_elements<Types>(
+                        array_ptrs_[type_index],
+                        array_ptrs_[type_index] + detail::array_bytes<Types>(size_)),
+                    ++type_index
+                ),
+                ...
+            );
+        }
+        this->sync_columns(0);
+    }
+
+    /*!
+     * Copy constructor.
+     */
+    SOAVector(SOAVector const & other)
+    {
+        this->reserve(other.size());
+
+        if (other.size() > 0)
+        {
+            std::size_t type_index = 0;
+            (
+                (
+                    copy_elements<Types>(
+                        other.array_ptrs_[type_index],
+                        other.array_ptrs_[type_index] + detail::array_bytes<Types>(other.size_),
+                        this->array_ptrs_[type_index]),
+                    copy_validity<Types>(
+                        other.array_ptrs_[type_index], other.capacity_,
+                        this->array_ptrs_[type_index], this->capacity_,
+                        other.size_),
+                    ++type_index
+                ),
+                ...
+            );
+        }
+        size_ = other.size_;
+        arenas_ = other.arenas_;
+    }
+
+    /*!
+     * Move constructor.
+     */
+    SOAVector(SOAVector && other):
+        array_ptrs_(other.array_ptrs_),
+        size_(other.size_),
+        capacity_(other.capacity_),
+        deleter_(std::move(other.deleter_)),
+        arenas_(std::move(other.arenas_))
+    {
+        std::fill(other.array_ptrs_.begin(), other.array_ptrs_.end(), nullptr);
+        other.size_ = 0;
+        other.capacity_ = 0;
+        // A moved-from 'std::function' may still hold the deleter.
+        other.deleter_ = nullptr;
+        other.clear_arenas();
+    }
+
+    /*!
+     * Destructor.
+     */
+    ~SOAVector()
+    {
+        if (capacity_ == 0)
+        {
+            return;
+        }
+        if (size_ > 0)
+        {
+            std::size_t type_index = 0;
+            (
+                (
+                    delete_elements<Types>(
+                        array_ptrs_[type_index],
+                        array_ptrs_[type_index] + detail::array_bytes<Types>(size_)),
+                    ++type_index
+                ),
+                ...
+            );
+        }
+        free_storage();
+    }
+
+    /*!
+     * Copy assignment operator.
+     */
+    SOAVector<Types...> & operator=(SOAVector<Types...> const & other)
+    {
+        if (&other == this)
+        {
+            // Avoid self assignment.
+            return *this;
+        }
+
+        this->clear();
+        this->reserve(other.size());
+
+        if (other.size() > 0)
+        {
+            std::size_t type_index = 0;
+            (
+                (
+                    copy_elements<Types>(
+                        other.array_ptrs_[type_index],
+                        other.array_ptrs_[type_index] + detail::array_bytes<Types>(other.size_),
+                        this->array_ptrs_[type_index]),
+                    copy_validity<Types>(
+                        other.array_ptrs_[type_index], other.capacity_,
+                        this->array_ptrs_[type_index], this->capacity_,
+                        other.size_),
+                    ++type_index
+                ),
+                ...
+            );
+        }
+        size_ = other.size_;
+        arenas_ = other.arenas_;
+
+        return *this;
+    }
+
+    /*!
+     * Move assignment operator.
+     */
+    SOAVector<Types...> & operator=(SOAVector<Types...> && other)
+    {
+        if (&other == this)
+        {
+            // Avoid self assignment.
+            return *this;
+        }
+
+        this->clear();
+        free_storage();
+
+        array_ptrs_ = other.array_ptrs_;
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+        deleter_ = std::move(other.deleter_);
+        arenas_ = std::move(other.arenas_);
+
+        std::fill(other.array_ptrs_.begin(), other.array_ptrs_.end(), nullptr);
+        other.size_ = 0;
+        other.capacity_ = 0;
+        // A moved-from 'std::function' may still hold the deleter.
+        other.deleter_ = nullptr;
+        other.clear_arenas();
+
+        return *this;
+    }
+
+    /*!
+     * Get whether the vector is empty.
+     *
+     * @return True if the vector is empty, otherwise false.
+     */
+    bool empty() const noexcept
+    {
+        return this->size_ == 0;
+    }
+
+    /*!
+     * Get the size, i.e. number of elements in the vector.
+     *
+     * @return The number of elements.
+     */
+    size_type size() const noexcept
+    {
+        return this->size_;
+    }
+
+    /*!
+     * Get the capacity, i.e. the number of elements the current memory
+     * allocation can fit.
+     *
+     * @return The capacity.
+     */
+    size_type capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    /*!
+     * Get the pointer to the first element of an array.
+     *
+     * @tparam TypeIndex The index of the array to get the pointer of.
+     * @return The pointer to the first element in the array.
      */
     template<size_type TypeIndex>
-    std::span<value_type<TypeIndex> const> span() const noexcept
+    value_type<TypeIndex> * data() noexcept
     {
-        return std::span<value_type<TypeIndex> const>(this->data<TypeIndex>(), this->size_);
+        return reinterpret_cast<value_type<TypeIndex> *>(array_ptrs_[TypeIndex]);
     }
 
     /*!
-     * Get a span over the elements in a certain array.
+     * Get the pointer to the first element of an array.
      *
-     * @tparam TypeIndex The index of the array.
-     * @return A span over the elements in the array.
+     * @tparam TypeIndex The index of the array to get the pointer of.
+     * @return The pointer to the first element in the array.
      */
     template<size_type TypeIndex>
-    std::span<value_type<TypeIndex>> span() noexcept
+    value_type<TypeIndex> const * data() const noexcept
+    {
+        return reinterpret_cast<value_type<TypeIndex> const *>(array_ptrs_[TypeIndex]);
+    }
+
+    /*!
+     * Get a reference to the element of a certain array at a given index.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @param index The index.
+     * @return A reference to the element at the position, a view of the
+     *      string for an 'ArenaString' array, a proxy reference to the flag for a
+     *      'PackedBool' array, or a copy of the value or 'std::nullopt' for
+     *      a 'Nullable' array.
+     */
+    template<size_type TypeIndex>
+    decltype(auto) get(size_type index) noexcept
+    {
+        assert(index < size_);
+        if constexpr (detail::is_nullable_column<value_type<TypeIndex>>)
+        {
+            using T = typename value_type<TypeIndex>::value_type;
+            return this->is_valid<TypeIndex>(index)
+                ? std::optional<T>(this->data<TypeIndex>()[index].value)
+                : std::optional<T>();
+        }
+        else
+        if constexpr (std::is_same_v<value_type<TypeIndex>, PackedBool>)
+        {
+            return PackedBool::reference(
+                this->data<TypeIndex>()[index / PackedBool::bits].word, index % PackedBool::bits);
+        }
+        else if constexpr (std::is_same_v<value_type<TypeIndex>, ArenaString>)
+        {
+            return this->string<TypeIndex>(index);
+        }
+        else
+        {
+            return *(this->data<TypeIndex>() + index);
+        }
+    }
+
+    /*!
+     * Get a reference to the element of a certain array at a given index.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @param index The index.
+     * @return A reference to the element at the position, a view of the
+     *      string for an 'ArenaString' array, the flag for a
+     *      'PackedBool' array, or a copy of the value or 'std::nullopt' for
+     *      a 'Nullable' array.
+     */
+    template<size_type TypeIndex>
+    decltype(auto) get(size_type index) const noexcept
+    {
+        assert(index < size_);
+        if constexpr (detail::is_nullable_column<value_type<TypeIndex>>)
+        {
+            using T = typename value_type<TypeIndex>::value_type;
+            return this->is_valid<TypeIndex>(index)
+                ? std::optional<T>(this->data<TypeIndex>()[index].value)
+                : std::optional<T>();
+        }
+        else
+        if constexpr (std::is_same_v<value_type<TypeIndex>, PackedBool>)
+        {
+            return (this->data<TypeIndex>()[index / PackedBool::bits].word >> (index % PackedBool::bits) & 1) != 0;
+        }
+        else if constexpr (std::is_same_v<value_type<TypeIndex>, ArenaString>)
+        {
+            return this->string<TypeIndex>(index);
+        }
+        else
+        {
+            return *(this->data<TypeIndex>() + index);
+        }
+    }
+
+    /*!
+     * Get a reference to the first element of a certain array.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @return A reference to the first element in the array.
+     */
+    template<size_type TypeIndex>
+    decltype(auto) front() noexcept
+    {
+        return this->get<TypeIndex>(0);
+    }
+
+    /*!
+     * Get a reference to the first element of a certain array.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @return A reference to the first element in the array.
+     */
+    template<size_type TypeIndex>
+    decltype(auto) front() const noexcept
+    {
+        return this->get<TypeIndex>(0);
+    }
+
+    /*!
+     * Get a reference to the last element of a certain array.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @return A reference to the last element in the array.
+     */
+    template<size_type TypeIndex>
+    decltype(auto) back() noexcept
+    {
+        return this->get<TypeIndex>(this->size_ - 1);
+    }
+
+    /*!
+     * Get a reference to the last element of a certain array.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @return A reference to the last element in the array.
+     */
+    template<size_type TypeIndex>
+    decltype(auto) back() const noexcept
+    {
+        return this->get<TypeIndex>(this->size_ - 1);
+    }
+
+    /*!
+     * Get the characters of all strings of an 'ArenaString' array.
+     *
+     * The string at index i spans the offsets from the end of string i - 1,
+     * or 0, to 'get<TypeIndex>()' of the end offsets in 'span<TypeIndex>()'.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @return The concatenated characters.
+     */
+    template<size_type TypeIndex>
+    std::string_view string_bytes() const noexcept
+    {
+        static_assert(std::is_same_v<value_type<TypeIndex>, ArenaString>, "Not an ArenaString array");
+        return std::string_view(arenas_[TypeIndex].data(), arenas_[TypeIndex].size());
+    }
+
+    /*!
+     * Get the validity bitmap of a 'Nullable' array.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @return The words of the bitmap, with the bit of each row holding a
+     *      value set.
+     */
+    template<size_type TypeIndex>
+    std::span<PackedBool const> validity() const noexcept
+    {
+        static_assert(detail::is_nullable_column<value_type<TypeIndex>>, "Not a Nullable array");
+        return std::span<PackedBool const>(
+            validity_words<value_type<TypeIndex>>(array_ptrs_[TypeIndex], capacity_), PackedBool::word_count(size_));
+    }
+
+    /*!
+     * Get the validity bitmap of a 'Nullable' array, e.g. to set rows to
+     * null or mark values written through 'span()' as valid.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @return The words of the bitmap, with the bit of each row holding a
+     *      value set. The bits past the last row must stay zero.
+     */
+    template<size_type TypeIndex>
+    std::span<PackedBool> validity() noexcept
+    {
+        static_assert(detail::is_nullable_column<value_type<TypeIndex>>, "Not a Nullable array");
+        return std::span<PackedBool>(
+            validity_words<value_type<TypeIndex>>(array_ptrs_[TypeIndex], capacity_), PackedBool::word_count(size_));
+    }
+
+    /*!
+     * Get a span over the elements in a certain array.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @return A span over the elements in the array, or over the words of a
+     *      'PackedBool' array.
+     */
+    template<size_type TypeIndex>
+    std::span<value_type<TypeIndex> const> span() const noexcept
+    {
+        return std::span<value_type<TypeIndex> const>(this->data<TypeIndex>(), this->array_length<TypeIndex>());
+    }
+
+    /*!
+     * Get a span over the elements in a certain array.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @return A span over the elements in the array, or over the words of a
+     *      'PackedBool' array.
+     */
+    template<size_type TypeIndex>
+    std::span<value_type<TypeIndex>> span() noexcept
+    {
+        return std::span<value_type<TypeIndex>>(this->data<TypeIndex>(), this->array_length<TypeIndex>());
+    }
+
+    /*!
+     * Get an atomic reference to the element of a certain array at a given index.
+     *
+     * Every array starts on a cache line boundary, so the elements meet the
+     * alignment required by 'std::atomic_ref' as long as it divides the
+     * element size.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @param index The index.
+     * @return An atomic reference to the element at the position.
+     */
+    template<size_type TypeIndex>
+    std::atomic_ref<value_type<TypeIndex>> atomic(size_type index) noexcept
+    {
+        using T = value_type<TypeIndex>;
+        static_assert(detail::is_plain_column<T>, "Elements of this array are not addressed by row");
+        static_assert(detail::cache_line_size % std::atomic_ref<T>::required_alignment == 0
+            && sizeof(T) % std::atomic_ref<T>::required_alignment == 0,
+            "Elements of this type cannot be aligned for atomic access");
+        assert(index < size_);
+        return std::atomic_ref<T>(*(this->data<TypeIndex>() + index));
+    }
+
+    /*!
+     * Atomically add values to elements of a certain array at given indices.
+     *
+     * Safe to call concurrently from several threads on the same array, e.g.
+     * for building histograms or accumulating forces. To reduce contention,
+     * the updates are first combined locally so that each element is updated
+     * atomically at most once per call: when the updates are dense relative
+     * to the size of the array they are accumulated in a private copy of the
+     * array, otherwise they are sorted by index and duplicates are summed.
+     * Sorting pays off when the updates repeat indices; for sparse updates
+     * that rarely collide, plain 'atomic()' additions are faster, as
+     * 'self_test::benchmark_scatter_add()' shows.
+     *
+     * @tparam TypeIndex The index of the array, which must be arithmetic and
+     *      not bool.
+     * @param indices The indices of the elements to add to.
+     * @param values The values to add, one per index.
+     */
+    template<size_type TypeIndex>
+    void scatter_add(std::span<size_type const> indices, std::span<value_type<TypeIndex> const> values)
+    {
+        using T = value_type<TypeIndex>;
+        static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>,
+            "scatter_add requires an arithmetic type other than bool");
+        assert(indices.size() == values.size());
+
+        if (indices.size() * dense_scatter_ratio >= size_)
+        {
+            // Privatize: accumulate into a local array, then publish once per element.
+            std::vector<T> sums(size_, T{});
+            std::vector<bool> touched(size_, false);
+            for (size_type i = 0; i < indices.size(); ++i)
+            {
+                assert(indices[i] < size_);
+                sums[indices[i]] += values[i];
+                touched[indices[i]] = true;
+            }
+            for (size_type index = 0; index < size_; ++index)
+            {
+                if (touched[index])
+                {
+                    this->atomic<TypeIndex>(index).fetch_add(sums[index], std::memory_order_relaxed);
+                }
+            }
+            return;
+        }
+
+        // Sort by index and sum runs of equal indices.
+        std::vector<std::pair<size_type, T>> updates(indices.size());
+        for (size_type i = 0; i < indices.size(); ++i)
+        {
+            assert(indices[i] < size_);
+            updates[i] = {indices[i], values[i]};
+        }
+        std::sort(updates.begin(), updates.end(), [](auto const & a, auto const & b) { return a.first < b.first; });
+        for (size_type i = 0; i < updates.size();)
+        {
+            size_type const index = updates[i].first;
+            T sum = updates[i].second;
+            for (++i; i < updates.size() && updates[i].first == index; ++i)
+            {
+                sum += updates[i].second;
+            }
+            this->atomic<TypeIndex>(index).fetch_add(sum, std::memory_order_relaxed);
+        }
+    }
+
+    /*!
+     * Get a view over a range of rows in all arrays.
+     *
+     * The view shares the memory allocation of the vector and is invalidated
+     * by any operation that reallocates.
+     *
+     * @param first The index of the first row in the view.
+     * @param count The number of rows in the view.
+     * @return A span over the rows [first, first + count).
+     */
+    SOASpan<Types...> slice(size_type first, size_type count) noexcept
+    {
+        return this->all_rows<Types...>().slice(first, count);
+    }
+
+    /*!
+     * Get a view over a range of rows in all arrays.
+     *
+     * @param first The index of the first row in the view.
+     * @param count The number of rows in the view.
+     * @return A read-only span over the rows [first, first + count).
+     */
+    SOASpan<Types const...> slice(size_type first, size_type count) const noexcept
+    {
+        return this->all_rows<Types const...>().slice(first, count);
+    }
+
+    /*!
+     * Split the rows into a number of roughly equal, disjoint views.
+     *
+     * See 'SOASpan::split()'. Since every array starts on a cache line
+     * boundary, the views never share a cache line.
+     *
+     * @param count The number of views.
+     * @return The views, in order, covering all rows of the vector.
+     */
+    std::vector<SOASpan<Types...>> split(size_type count)
+    {
+        return this->all_rows<Types...>().split(count);
+    }
+
+    /*!
+     * Split the rows into a number of roughly equal, disjoint views.
+     *
+     * @param count The number of views.
+     * @return The read-only views, in order, covering all rows of the vector.
+     */
+    std::vector<SOASpan<Types const...>> split(size_type count) const
+    {
+        return this->all_rows<Types const...>().split(count);
+    }
+
+    /*!
+     * Clears the contents, deleting all elements of all arrays.
+     *
+     * Calling 'clear()' does not change the memory allocation and change the
+     * capacity.
+     */
+    void clear()
+    {
+        if (size_ > 0)
+        {
+            std::size_t type_index = 0;
+            (
+                (
+                    delete_elements<Types>(
+                        array_ptrs_[type_index],
+                        array_ptrs_[type_index] + detail::array_bytes<Types>(size_)),
+                    ++type_index
+                ),
+                ...
+            );
+        }
+        size_ = 0;
+        this->clear_arenas();
+    }
+
+    /*!
+     * Change the number of elements in each array.
+     *
+     * Elements beyond the new size are deleted, new elements are default
+     * initialized, i.e. empty strings for 'ArenaString' arrays. Existing
+     * elements are kept, so their own memory allocations can be reused when
+     * overwriting them.
+     *
+     * @param new_size The new number of elements.
+     */
+    void resize(size_type new_size)
+    {
+        size_type const old_size = size_;
+        if (new_size < size_)
+        {
+            std::size_t type_index = 0;
+            (
+                (
+                    delete_elements<Types>(
+                        array_ptrs_[type_index] + detail::array_bytes<Types>(new_size),
+                        array_ptrs_[type_index] + detail::array_bytes<Types>(size_)),
+                    ++type_index
+                ),
+                ...
+            );
+        }
+        else if (new_size > size_)
+        {
+            this->reserve(new_size);
+            std::size_t type_index = 0;
+            (
+                (
+                    create_default_elements<Types>(
+                        array_ptrs_[type_index] + detail::array_bytes<Types>(size_),
+                        array_ptrs_[type_index] + detail::array_bytes<Types>(new_size)),
+                    ++type_index
+                ),
+                ...
+            );
+        }
+        size_ = new_size;
+        this->sync_columns(old_size);
+    }
+
+    /*!
+     * Adds a set of elements at the end of each array.
+     *
+     * @param args The elements to add, as 'std::string_view' for
+     *      'ArenaString' arrays.
+     */
+    void push_back(typename detail::ColumnArgument<Types>::type... args)
+    {
+        // Grow the capacity if we have to.
+        if (size_ + 1 > capacity_)
+        {
+            this->reserve(this->size_ * growth_factor + 1);
+        }
+
+        std::size_t type_index = 0;
+        (
+            (
+                this->create_column_element<Types>(type_index, std::forward<decltype(args)>(args)),
+                ++type_index
+            ),
+            ...
+        );
+        ++size_;
+    }
+
+    /*!
+     * Adds copies of a range of rows at the end of each array.
+     *
+     * Grows the capacity at most once for the whole range.
+     *
+     * @param rows The rows to add. Must not refer to this vector.
+     */
+    void append(SOASpan<Types const...> rows)
+    {
+        static_assert((detail::is_plain_column<Types> && ...),
+            "Views cannot hold the rows of ArenaString, PackedBool or Nullable columns");
+        if (size_ + rows.size() > capacity_)
+        {
+            this->reserve(std::max<size_type>(size_ + rows.size(), this->size_ * growth_factor + 1));
+        }
+
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            (
+                std::uninitialized_copy_n(
+                    rows.template data<TypeIndices>(),
+                    rows.size(),
+                    this->data<TypeIndices>() + size_),
+                ...
+            );
+        }(std::index_sequence_for<Types...>{});
+        size_ += rows.size();
+    }
+
+    /*!
+     * Moves all rows of another vector to the end of each array.
+     *
+     * Grows the capacity at most once. The other vector is left empty but
+     * keeps its memory allocation, so it can be reused as a buffer.
+     *
+     * @param other The vector to move the rows from.
+     */
+    void append(SOAVector && other)
+    {
+        assert(&other != this);
+        if (size_ + other.size_ > capacity_)
+        {
+            this->reserve(std::max<size_type>(size_ + other.size_, this->size_ * growth_factor + 1));
+        }
+
+        if (other.size_ > 0)
+        {
+            std::size_t type_index = 0;
+            (
+                (
+                    this->move_column<Types>(type_index, other),
+                    ++type_index
+                ),
+                ...
+            );
+        }
+        size_ += other.size_;
+        other.size_ = 0;
+    }
+
+    /*!
+     * Remove the last element of each array.
+     */
+    void pop_back()
+    {
+        assert(size_ > 0);
+
+        std::size_t type_index = 0;
+        (
+            (
+                delete_elements<Types>(
+                    array_ptrs_[type_index] + detail::array_bytes<Types>(size_ - 1),
+                    array_ptrs_[type_index] + detail::array_bytes<Types>(size_)),
+                ++type_index
+            ),
+            ...
+        );
+        --size_;
+        this->sync_columns(size_ + 1);
+    }
+
+    /*!
+     * Reserve storage.
+     *
+     * @param new_capacity The new capacity of the arrays. Will only
+     *      reallocate if 'new_capacity' is larger than the current capacity.
+     */
+    void reserve(size_type new_capacity)
+    {
+        if (new_capacity > capacity_)
+        {
+            reallocate(new_capacity);
+        }
+    }
+
+    /*!
+     * Reduce the memory allocation to fit only the current size.
+     */
+    void shrink_to_fit()
+    {
+        if (capacity_ > size_)
+        {
+            reallocate(size_);
+        }
+    }
+
+    /*!
+     * Release the memory allocation without destroying the elements.
+     *
+     * The caller becomes responsible for destroying the elements and freeing
+     * the allocation by calling the returned deleter. The vector is left empty.
+     *
+     * @return The memory allocation, or an empty storage if the vector has none.
+     */
+    Storage release() noexcept
+    {
+        static_assert(!has_arena_columns, "The characters of ArenaString columns are not part of the allocation");
+        if (capacity_ == 0)
+        {
+            return Storage{};
+        }
+
+        Storage storage;
+        storage.data = array_ptrs_[0];
+        storage.offsets = calculate_array_offsets_and_allocation_size(capacity_).first;
+        storage.size = size_;
+        storage.capacity = capacity_;
+        storage.deleter = deleter_ ? std::move(deleter_) : default_deleter;
+
+        std::fill(array_ptrs_.begin(), array_ptrs_.end(), nullptr);
+        size_ = 0;
+        capacity_ = 0;
+        deleter_ = nullptr;
+
+        return storage;
+    }
+
+    /*!
+     * Calculate the pointer offsets of each array and the total required memory
+     * allocation size for a specific size of the vector.
+     *
+     * @param element_count The number of elements to get the size and
+     *      offsets for.
+     * @return An array with the pointer offsets of each array and the
+     *      required memory allocation size.
+     */
+    static constexpr std::pair<std::array<ptrdiff_t, sizeof...(Types)>, size_t>
+    calculate_array_offsets_and_allocation_size(size_type element_count)
+    {
+        // Get the byte sizes and alignments of the arrays. Each array starts
+        // on a cache line so that disjoint row ranges never share one.
+        const auto sizes = std::array{detail::allocation_bytes<Types>(element_count)...};
+        const auto alignments = std::array{std::max(alignof(Types), detail::cache_line_size)...};
+
+        // Calculate the offsets of each array from the start of the allocation.
+        std::array<ptrdiff_t, sizeof...(Types)> offsets{};
+        ptrdiff_t p = sizes[0];
+        for (size_type i = 1; i < sizeof...(Types); ++i)
+        {
+            p = (p + alignments[i] - 1) / alignments[i] * alignments[i];
+            offsets[i] = p;
+            p += sizes[i];
+        }
+
+        return {offsets, p};
+    }
+
+private:
+    /*!
+     * Get a span over all rows.
+     *
+     * @tparam SpanTypes The element types of the span, either 'Types...' or
+     *      'Types const...'.
+     */
+    template<typename... SpanTypes>
+    SOASpan<SpanTypes...> all_rows() const noexcept
+    {
+        static_assert(((!std::is_same_v<Types, PackedBool> && !detail::is_nullable_column<Types>) && ...),
+            "Views cannot address the rows of PackedBool arrays or the validity of Nullable arrays");
+        return [this]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            return SOASpan<SpanTypes...>(size_, reinterpret_cast<SpanTypes *>(array_ptrs_[TypeIndices])...);
+        }(std::index_sequence_for<Types...>{});
+    }
+
+    /*!
+     * Get the number of elements of an array, i.e. the number of words of a
+     * 'PackedBool' array and the size otherwise.
+     */
+    template<size_type TypeIndex>
+    size_type array_length() const noexcept
+    {
+        if constexpr (std::is_same_v<value_type<TypeIndex>, PackedBool>)
+        {
+            return PackedBool::word_count(size_);
+        }
+        else
+        {
+            return size_;
+        }
+    }
+
+    /*!
+     * Get whether a row of a 'Nullable' array holds a value.
+     */
+    template<size_type TypeIndex>
+    bool is_valid(size_type index) const noexcept
+    {
+        PackedBool const * const words = validity_words<value_type<TypeIndex>>(array_ptrs_[TypeIndex], capacity_);
+        return (words[index / PackedBool::bits].word >> (index % PackedBool::bits) & 1) != 0;
+    }
+
+    /*!
+     * Get the validity bitmap of a 'Nullable' array.
+     *
+     * @param array_ptr The start of the array.
+     * @param capacity The capacity of the allocation the array is part of.
+     */
+    template<typename T>
+    static PackedBool * validity_words(char * const array_ptr, size_type capacity) noexcept
+    {
+        return reinterpret_cast<PackedBool *>(array_ptr + detail::validity_offset<T>(capacity));
+    }
+
+    /*!
+     * Copy the validity bitmap of a 'Nullable' array to another allocation.
+     * Does nothing for other arrays.
+     *
+     * @param src The start of the array to copy from.
+     * @param src_capacity The capacity of its allocation.
+     * @param dst The start of the array to copy to.
+     * @param dst_capacity The capacity of its allocation.
+     * @param size The number of rows to copy.
+     */
+    template<typename T>
+    static void copy_validity(char * const src, size_type src_capacity, char * const dst, size_type dst_capacity,
+                              size_type size) noexcept
+    {
+        if constexpr (detail::is_nullable_column<T>)
+        {
+            if (size > 0)
+            {
+                std::memcpy(validity_words<T>(dst, dst_capacity), validity_words<T>(src, src_capacity),
+                            PackedBool::word_count(size) * sizeof(PackedBool));
+            }
+        }
+    }
+
+    /*!
+     * Append the bits of one bitset to another.
+     *
+     * @param dst The words of the bitset to append to, with room for the
+     *      appended bits.
+     * @param dst_size The number of bits in it.
+     * @param src The words of the bitset to append.
+     * @param src_size The number of bits in it.
+     */
+    static void append_bits(PackedBool * dst, size_type dst_size, PackedBool const * const src, size_type src_size) noexcept
+    {
+        constexpr std::size_t bits = PackedBool::bits;
+        size_type const src_words = PackedBool::word_count(src_size);
+        size_type const dst_words = PackedBool::word_count(dst_size + src_size) - dst_size / bits;
+        size_type const shift = dst_size % bits;
+        dst += dst_size / bits;
+        if (shift == 0)
+        {
+            std::memcpy(dst, src, src_words * sizeof(PackedBool));
+            return;
+        }
+        for (size_type i = 0; i < src_words; ++i)
+        {
+            dst[i].word |= src[i].word << shift;
+            if (i + 1 < dst_words)
+            {
+                dst[i + 1] = PackedBool{src[i].word >> (bits - shift)};
+            }
+        }
+    }
+
+    /*!
+     * Get the string at an index of an 'ArenaString' array.
+     */
+    template<size_type TypeIndex>
+    std::string_view string(size_type index) const noexcept
+    {
+        ArenaString const * const ends = this->data<TypeIndex>();
+        std::uint64_t const begin = index == 0 ? 0 : ends[index - 1].end;
+        return std::string_view(arenas_[TypeIndex].data() + begin, ends[index].end - begin);
+    }
+
+    /*!
+     * Create the element at the end of an array, appending the characters
+     * of strings to the arena of 'ArenaString' arrays and setting the bit
+     * of 'PackedBool' arrays or the validity bit of 'Nullable' arrays.
+     */
+    template<typename T, typename Arg>
+    void create_column_element(std::size_t type_index, Arg && arg)
+    {
+        if constexpr (std::is_same_v<T, PackedBool>)
+        {
+            PackedBool & word = reinterpret_cast<PackedBool *>(array_ptrs_[type_index])[size_ / PackedBool::bits];
+            if (size_ % PackedBool::bits == 0)
+            {
+                create_element(reinterpret_cast<char *>(&word), PackedBool{});
+            }
+            word.word |= std::uint64_t(arg) << (size_ % PackedBool::bits);
+        }
+        else if constexpr (std::is_same_v<T, ArenaString>)
+        {
+            std::vector<char> & arena = arenas_[type_index];
+            arena.insert(arena.end(), arg.begin(), arg.end());
+            create_element(array_ptrs_[type_index] + size_ * sizeof(T), ArenaString{arena.size()});
+        }
+        else if constexpr (detail::is_nullable_column<T>)
+        {
+            PackedBool & word = validity_words<T>(array_ptrs_[type_index], capacity_)[size_ / PackedBool::bits];
+            if (size_ % PackedBool::bits == 0)
+            {
+                word = PackedBool{};
+            }
+            word.word |= std::uint64_t(arg.has_value()) << (size_ % PackedBool::bits);
+            create_element(array_ptrs_[type_index] + size_ * sizeof(T), arg ? T{std::move(*arg)} : T());
+        }
+        else
+        {
+            create_element(array_ptrs_[type_index] + size_ * sizeof(T), std::forward<Arg>(arg));
+        }
+    }
+
+    /*!
+     * Move the elements of an array of another vector to the end of this
+     * one's. The characters of an 'ArenaString' array are moved along and
+     * the end offsets rebased on them, the bits of a 'PackedBool' array or
+     * the validity bitmap of a 'Nullable' array are shifted into place after
+     * the last row.
+     */
+    template<typename T>
+    void move_column(std::size_t type_index, SOAVector & other)
+    {
+        if constexpr (std::is_same_v<T, PackedBool>)
+        {
+            append_bits(
+                reinterpret_cast<PackedBool *>(array_ptrs_[type_index]), size_,
+                reinterpret_cast<PackedBool const *>(other.array_ptrs_[type_index]), other.size_);
+        }
+        else if constexpr (std::is_same_v<T, ArenaString>)
+        {
+            move_elements<T>(
+                other.array_ptrs_[type_index],
+                other.array_ptrs_[type_index] + detail::array_bytes<T>(other.size_),
+                array_ptrs_[type_index] + detail::array_bytes<T>(size_));
+            std::vector<char> & arena = arenas_[type_index];
+            std::uint64_t const base = arena.size();
+            arena.insert(arena.end(), other.arenas_[type_index].begin(), other.arenas_[type_index].end());
+            other.arenas_[type_index].clear();
+            ArenaString * const ends = reinterpret_cast<ArenaString *>(array_ptrs_[type_index]);
+            for (size_type i = size_; i < size_ + other.size_; ++i)
+            {
+                ends[i].end += base;
+            }
+        }
+        else
+        {
+            move_elements<T>(
+                other.array_ptrs_[type_index],
+                other.array_ptrs_[type_index] + detail::array_bytes<T>(other.size_),
+                array_ptrs_[type_index] + detail::array_bytes<T>(size_));
+            if constexpr (detail::is_nullable_column<T>)
+            {
+                append_bits(
+                    validity_words<T>(array_ptrs_[type_index], capacity_), size_,
+                    validity_words<T>(other.array_ptrs_[type_index], other.capacity_), other.size_);
+            }
+        }
+    }
+
+    /*!
+     * Bring 'ArenaString', 'PackedBool' and 'Nullable' arrays in line with a
+     * new size: drop the characters of removed strings, or make added
+     * elements empty strings, clear the bits of removed flags, and make added
+     * elements null.
+     *
+     * @param old_size The size before the change.
+     */
+    void sync_columns(size_type old_size) noexcept
+    {
+        if constexpr ((!detail::is_plain_column<Types> || ...))
+        {
+            std::size_t type_index = 0;
+            (
+                (
+                    [&]
+                    {
+                        if constexpr (std::is_same_v<Types, PackedBool> || detail::is_nullable_column<Types>)
+                        {
+                            PackedBool * const words = std::is_same_v<Types, PackedBool>
+                                ? reinterpret_cast<PackedBool *>(array_ptrs_[type_index])
+                                : validity_words<Types>(array_ptrs_[type_index], capacity_);
+                            if (size_ < old_size && size_ % PackedBool::bits != 0)
+                            {
+                                words[size_ / PackedBool::bits].word &=
+                                    (std::uint64_t(1) << (size_ % PackedBool::bits)) - 1;
+                            }
+                            if constexpr (detail::is_nullable_column<Types>)
+                            {
+                                // New words of packed arrays are default constructed with the elements.
+                                if (size_ > old_size)
+                                {
+                                    std::fill(words + PackedBool::word_count(old_size),
+                                              words + PackedBool::word_count(size_), PackedBool{});
+                                }
+                            }
+                        }
+                        else if constexpr (std::is_same_v<Types, ArenaString>)
+                        {
+                            std::vector<char> & arena = arenas_[type_index];
+                            ArenaString * const ends = reinterpret_cast<ArenaString *>(array_ptrs_[type_index]);
+                            if (size_ < old_size)
+                            {
+                                arena.resize(size_ == 0 ? 0 : ends[size_ - 1].end);
+                            }
+                            for (size_type i = old_size; i < size_; ++i)
+                            {
+                                ends[i].end = arena.size();
+                            }
+                        }
+                    }(),
+                    ++type_index
+                ),
+                ...
+            );
+        }
+    }
+
+    /*!
+     * Remove the characters of all 'ArenaString' arrays.
+     */
+    void clear_arenas() noexcept
+    {
+        for (std::vector<char> & arena : arenas_)
+        {
+            arena.clear();
+        }
+    }
+
+    /*!
+     * Free the current memory allocation, if any.
+     */
+    void free_storage() noexcept
+    {
+        if (capacity_ > 0)
+        {
+            if (deleter_)
+            {
+                deleter_(array_ptrs_[0]);
+                deleter_ = nullptr;
+            }
+            else
+            {
+                default_deleter(array_ptrs_[0]);
+            }
+        }
+    }
+
+    /*!
+     * Free a memory allocation made by the vector itself.
+     *
+     * @param ptr The start of the memory allocation.
+     */
+    static void default_deleter(char * const ptr) noexcept
+    {
+        ::operator delete[](ptr, std::align_val_t(allocation_alignment));
+    }
+
+    /*!
+     * Create a range of default initialized elements in existing memory allocation.
+     *
+     * @param first The pointer to where the first element should be created.
+     * @param last The pointer to where one past the last last element should
+     *      be created.
+     */
+    template<typename T>
+    static void create_default_elements(char * const first, char * const last)
+    {
+        for (char * it = first; it != last; it += sizeof(T))
+        {
+            // Create a new default object in destination
+            new(it) T();
+        }
+    }
+
+    /*!
+     * Create an element with a specific value in existing memory allocation.
+     *
+     * @param ptr The pointer to where the element should be created.
+     * @param value The value of the element.
+     */
+    template<typename T>
+    static void create_element(char * const ptr, T&& value)
+    {
+        new(ptr) T(std::forward<T>(value));
+    }
+
+    /*!
+     * Delete an element at a specific location in existing memory allocation.
+     *
+     * @param ptr The pointer to the element.
+     */
+    template<typename T>
+    static void delete_element(char * const ptr)
+    {
+        reinterpret_cast<T *>(ptr)->~T();
+    }
+
+    /*!
+     * Call destructor on a range of elements.
+     *
+     * @param first The pointer to the first element to delete.
+     * @param last The pointer to one past the last element to delete.
+     */
+    template<typename T>
+    static void delete_elements(char * const first, char * const last)
+    {
+        for (char * it = first; it != last; it += sizeof(T))
+        {
+            reinterpret_cast<T *>(it)->~T();
+        }
+    }
+
+    /*!
+     * Copy a range of elements to a new location in an existing memory allocation.
+     *
+     * @param first A pointer to the first element to copy.
+     * @param last A pointer to one past the last element to copy.
+     * @param dst_first A pointer to the first element in the new location.
+     */
+    template<typename T>
+    static void copy_elements(char const * const first, char const * const last, char * dst_first)
+    {
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            if (first != last)
+            {
+                std::memcpy(dst_first, first, last - first);
+            }
+            return;
+        }
+        for (char const * it = first; it != last; it += sizeof(T), dst_first += sizeof(T))
+        {
+            T const * const original_obj_ptr = reinterpret_cast<T const *>(it);
+            // Create a new object in destination as a copy of original.
+            new(dst_first) T(*original_obj_ptr);
+        }
+    }
+
+    /*!
+     * Move a range of elements to a new location in an existing memory allocation.
+     *
+     * @param first A pointer to the first element to move.
+     * @param last A pointer to one past the last element to move.
+     * @param dst_first A pointer to the first element in the new location.
+     */
+    template<typename T>
+    static void move_elements(char * const first, char * const last, char * dst_first)
+    {
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            // Moving and destroying is a plain copy of the bytes.
+            if (first != last)
+            {
+                std::memcpy(dst_first, first, last - first);
+            }
+            return;
+        }
+        for (char * it = first; it != last; it += sizeof(T), dst_first += sizeof(T))
+        {
+            T * const original_obj_ptr = reinterpret_cast<T *>(it);
+            // Create a new object in destination, possibly by invoking move constructor.
+            new(dst_first) T(std::move(*original_obj_ptr));
+            // Delete the previous object
+            original_obj_ptr->~T();
+        }
+    }
+
+    /*!
+     * Reallocate the data to a new memory allocation of a specific capacity.
+     *
+     * This will allocate a new chunk of memory, move the elements there,
+     * destruct the original elements and free the original memory allocation.
+     *
+     * @param new_capacity The capacity of the new memory allocation.
+     */
+    void reallocate(size_type new_capacity)
+    {
+        assert(new_capacity >= size_);
+
+        // Get the byte offsets for each array as well as the total number of bytes needed.
+        auto const [new_offsets, total_num_bytes] = calculate_array_offsets_and_allocation_size(new_capacity);
+
+        // Allocate memory aligned to a cache line or the most strictly aligned type.
+        char * const new_data_ptr = static_cast<char *>(
+            ::operator new[](total_num_bytes, std::align_val_t(allocation_alignment)));
+
+        std::array<char *, sizeof...(Types)> new_array_ptrs{};
+        for (std::size_t array_index = 0; array_index < new_array_ptrs.size(); ++array_index)
+        {
+            new_array_ptrs[array_index] = new_data_ptr + new_offsets[array_index];
+        }
+
+        if (size_ > 0)
+        {
+            // Move existing objects to the new memory allocation.
+            std::size_t type_index = 0;
+            (
+                (
+                    move_elements<Types>(
+                        array_ptrs_[type_index],
+                        array_ptrs_[type_index] + detail::array_bytes<Types>(size_),
+                        new_array_ptrs[type_index]),
+                    copy_validity<Types>(array_ptrs_[type_index], capacity_, new_array_ptrs[type_index], new_capacity, size_),
+                    ++type_index
+                ),
+                ...
+            );
+        }
+
+        free_storage();
+        array_ptrs_ = std::move(new_array_ptrs);
+        capacity_ = new_capacity;
+    }
+
+    // Member variables:
+    std::array<char *, sizeof...(Types)> array_ptrs_{};
+    size_type size_ = 0;
+    size_type capacity_ = 0;
+    std::function<void(char *)> deleter_;
+    std::array<std::vector<char>, has_arena_columns ? sizeof...(Types) : 0> arenas_;
+    static constexpr float growth_factor = 1.5;
+    static constexpr size_type dense_scatter_ratio = 4;
+};
+
+/*!
+ * SOA vector that many threads can append to concurrently without locks.
+ *
+ * Producers reserve row slots by atomically incrementing a counter, construct
+ * their elements without any locking and then publish them by advancing a
+ * committed watermark in reservation order. Readers only see rows below the
+ * watermark, which are fully constructed.
+ *
+ * Rows are stored in segments, each a single memory allocation with the same
+ * layout as a 'SOAVector'. Segment 'k' holds 'first_segment_capacity << k'
+ * rows, so growing never moves existing elements and references to them stay
+ * valid for the lifetime of the container.
+ *
+ * A producer that has reserved slots must commit them, otherwise later
+ * producers wait forever. Element construction should therefore not throw.
+ */
+template <detail::PlainColumn... Types>
+class ConcurrentAppendSOAVector
+{
+public:
+    /*!
+     * The value type of the N'th template argument.
+     */
+    template <std::size_t i>
+    using value_type = decltype(detail::IndexToType<i, Types...>::value);
+
+    using size_type = std::size_t;
+
+    /*!
+     * Create an empty vector.
+     *
+     * @param first_segment_capacity The number of rows in the first segment.
+     *      Rounded up to a power of two.
+     */
+    explicit ConcurrentAppendSOAVector(size_type first_segment_capacity = 1024):
+        first_segment_shift_(std::bit_width(std::max(first_segment_capacity, size_type{1}) - 1))
+    {
+        for (auto & segment : segments_)
+        {
+            segment.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ConcurrentAppendSOAVector(ConcurrentAppendSOAVector const &) = delete;
+    ConcurrentAppendSOAVector & operator=(ConcurrentAppendSOAVector const &) = delete;
+
+    /*!
+     * Destructor.
+     *
+     * Must not run concurrently with any other member function.
+     */
+    ~ConcurrentAppendSOAVector()
+    {
+        assert(reserved_.load() == committed_.load());
+
+        size_type const size = committed_.load(std::memory_order_acquire);
+        for (size_type segment_index = 0; segment_index < segments_.size(); ++segment_index)
+        {
+            char * const segment = segments_[segment_index].load(std::memory_order_acquire);
+            if (segment == nullptr)
+            {
+                continue;
+            }
+
+            size_type const first = segment_first_row(segment_index);
+            if (size > first)
+            {
+                size_type const count = std::min(size - first, segment_capacity(segment_index));
+                auto const offsets = Layout::calculate_array_offsets_and_allocation_size(
+                    segment_capacity(segment_index)).first;
+                std::size_t type_index = 0;
+                (
+                    (
+                        destroy_elements<Types>(segment + offsets[type_index], count),
+                        ++type_index
+                    ),
+                    ...
+                );
+            }
+            ::operator delete[](segment, std::align_val_t(Layout::allocation_alignment));
+        }
+    }
+
+    /*!
+     * Get the number of committed rows.
+     *
+     * Rows below this are fully constructed and visible to the calling thread.
+     *
+     * @return The number of committed rows.
+     */
+    size_type size() const noexcept
+    {
+        return committed_.load(std::memory_order_acquire);
+    }
+
+    /*!
+     * Get whether there are no committed rows.
+     *
+     * @return True if no rows are committed, otherwise false.
+     */
+    bool empty() const noexcept
+    {
+        return this->size() == 0;
+    }
+
+    /*!
+     * Get a reference to the element of a certain array at a given index.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @param index The index, which must be below 'size()'.
+     * @return A reference to the element at the position.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> & get(size_type index) noexcept
+    {
+        return *(this->segment_data<TypeIndex>(index));
+    }
+
+    /*!
+     * Get a reference to the element of a certain array at a given index.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @param index The index, which must be below 'size()'.
+     * @return A reference to the element at the position.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> const & get(size_type index) const noexcept
+    {
+        return *(this->segment_data<TypeIndex>(index));
+    }
+
+    /*!
+     * Adds a set of elements at the end of each array.
+     *
+     * Safe to call concurrently from any number of threads.
+     *
+     * @param args The elements to add.
+     * @return The index of the added row.
+     */
+    size_type push_back(Types&&... args)
+    {
+        size_type const index = reserved_.fetch_add(1, std::memory_order_relaxed);
+        char * const segment = this->acquire_segment(segment_index(index));
+        size_type const segment_row = index - segment_first_row(segment_index(index));
+        auto const offsets = Layout::calculate_array_offsets_and_allocation_size(
+            segment_capacity(segment_index(index))).first;
+
+        std::size_t type_index = 0;
+        (
+            (
+                new(segment + offsets[type_index] + segment_row * sizeof(Types)) Types(std::forward<decltype(args)>(args)),
+                ++type_index
+            ),
+            ...
+        );
+
+        this->commit(index, 1);
+        return index;
+    }
+
+    /*!
+     * Adds a range of rows at the end of each array with a single reservation.
+     *
+     * The rows are guaranteed to be contiguous. Safe to call concurrently
+     * from any number of threads.
+     *
+     * @param rows The rows to copy.
+     * @return The index of the first added row.
+     */
+    size_type append(SOASpan<Types const...> rows)
+    {
+        size_type const first = reserved_.fetch_add(rows.size(), std::memory_order_relaxed);
+
+        size_type copied = 0;
+        while (copied < rows.size())
+        {
+            size_type const index = first + copied;
+            size_type const segment_index = this->segment_index(index);
+            char * const segment = this->acquire_segment(segment_index);
+            size_type const segment_row = index - segment_first_row(segment_index);
+            size_type const count = std::min(
+                rows.size() - copied, segment_capacity(segment_index) - segment_row);
+            auto const offsets = Layout::calculate_array_offsets_and_allocation_size(
+                segment_capacity(segment_index)).first;
+
+            [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+            {
+                (
+                    std::uninitialized_copy_n(
+                        rows.template data<TypeIndices>() + copied,
+                        count,
+                        reinterpret_cast<Types *>(segment + offsets[TypeIndices]) + segment_row),
+                    ...
+                );
+            }(std::index_sequence_for<Types...>{});
+            copied += count;
+        }
+
+        this->commit(first, rows.size());
+        return first;
+    }
+
+    /*!
+     * Call a function with a span over the committed rows of each segment.
+     *
+     * @param func The function, called as 'func(SOASpan<Types const...>)' for
+     *      each non-empty segment in order.
+     */
+    template <typename Func>
+    void for_each_segment(Func && func) const
+    {
+        size_type const size = this->size();
+        for (size_type segment_index = 0; segment_first_row(segment_index) < size; ++segment_index)
+        {
+            size_type const first = segment_first_row(segment_index);
+            size_type const count = std::min(size - first, segment_capacity(segment_index));
+            char * const segment = segments_[segment_index].load(std::memory_order_acquire);
+            auto const offsets = Layout::calculate_array_offsets_and_allocation_size(
+                segment_capacity(segment_index)).first;
+
+            [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+            {
+                func(SOASpan<Types const...>(
+                    count, reinterpret_cast<Types const *>(segment + offsets[TypeIndices])...));
+            }(std::index_sequence_for<Types...>{});
+        }
+    }
+
+private:
+    using Layout = SOAVector<Types...>;
+
+    /*!
+     * Get the index of the segment holding a row.
+     */
+    size_type segment_index(size_type index) const noexcept
+    {
+        return std::bit_width((index >> first_segment_shift_) + 1) - 1;
+    }
+
+    /*!
+     * Get the index of the first row in a segment.
+     */
+    size_type segment_first_row(size_type segment_index) const noexcept
+    {
+        return ((size_type{1} << segment_index) - 1) << first_segment_shift_;
+    }
+
+    /*!
+     * Get the number of rows in a segment.
+     */
+    size_type segment_capacity(size_type segment_index) const noexcept
+    {
+        return size_type{1} << (first_segment_shift_ + segment_index);
+    }
+
+    /*!
+     * Get a pointer to an element, which must be in an allocated segment.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> * segment_data(size_type index) const noexcept
+    {
+        assert(index < reserved_.load(std::memory_order_relaxed));
+        size_type const segment_index = this->segment_index(index);
+        char * const segment = segments_[segment_index].load(std::memory_order_acquire);
+        auto const offsets = Layout::calculate_array_offsets_and_allocation_size(
+            segment_capacity(segment_index)).first;
+        return reinterpret_cast<value_type<TypeIndex> *>(segment + offsets[TypeIndex])
+            + (index - segment_first_row(segment_index));
+    }
+
+    /*!
+     * Get a segment, allocating it if no other thread has yet.
+     */
+    char * acquire_segment(size_type segment_index)
+    {
+        char * segment = segments_[segment_index].load(std::memory_order_acquire);
+        if (segment != nullptr)
+        {
+            return segment;
+        }
+
+        auto const allocation_size = Layout::calculate_array_offsets_and_allocation_size(
+            segment_capacity(segment_index)).second;
+        char * const new_segment = static_cast<char *>(
+            ::operator new[](allocation_size, std::align_val_t(Layout::allocation_alignment)));
+        if (segments_[segment_index].compare_exchange_strong(
+                segment, new_segment, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            return new_segment;
+        }
+
+        // Another thread installed the segment first.
+        ::operator delete[](new_segment, std::align_val_t(Layout::allocation_alignment));
+        return segment;
+    }
+
+    /*!
+     * Publish a range of constructed rows once all earlier rows are published.
+     */
+    void commit(size_type first, size_type count) noexcept
+    {
+        for (unsigned spin = 0; committed_.load(std::memory_order_acquire) != first; ++spin)
+        {
+            if (spin > 64)
+            {
+                std::this_thread::yield();
+            }
+        }
+        committed_.store(first + count, std::memory_order_release);
+    }
+
+    /*!
+     * Call destructor on a number of elements.
+     */
+    template<typename T>
+    static void destroy_elements(char * const first, size_type count) noexcept
+    {
+        std::destroy_n(reinterpret_cast<T *>(first), count);
+    }
+
+    // Member variables:
+    std::array<std::atomic<char *>, 64> segments_;
+    size_type first_segment_shift_;
+    alignas(detail::cache_line_size) std::atomic<size_type> reserved_{0};
+    alignas(detail::cache_line_size) std::atomic<size_type> committed_{0};
+};
+
+/*!
+ * SOA vector with a single writer and any number of wait-free readers.
+ *
+ * The writer appends rows and publishes the current memory allocation and
+ * size atomically. Readers take a snapshot without locking and can read the
+ * rows it contains until the snapshot is destroyed, even if the writer
+ * reallocates in the meantime.
+ *
+ * When the writer outgrows an allocation, the elements are copied to a new
+ * one, and the old allocation is retired. Retired allocations are freed using
+ * epoch-based reclamation: each snapshot records the global epoch when it is
+ * taken, and an allocation retired in epoch 'e' is freed once no snapshot
+ * from epoch 'e' or earlier is still alive.
+ *
+ * The writer never modifies rows once they are published, so readers need no
+ * synchronization beyond taking the snapshot.
+ */
+template <detail::PlainColumn... Types>
+class SnapshotSOAVector
+{
+    /*!
+     * A memory allocation with the same layout as a 'SOAVector'.
+     */
+    struct Block
+    {
+        std::array<char *, sizeof...(Types)> array_ptrs{};
+        std::size_t size = 0;
+        std::size_t capacity = 0;
+    };
+
+    /*!
+     * The epoch of a reader, padded to avoid false sharing between readers.
+     */
+    struct alignas(detail::cache_line_size) ReaderSlot
+    {
+        std::atomic<std::uint64_t> epoch{inactive_epoch};
+        std::atomic<bool> in_use{false};
+    };
+
+    /*!
+     * A block waiting for all readers of its epoch to finish.
+     */
+    struct RetiredBlock
+    {
+        Block * block;
+        std::uint64_t epoch;
+    };
+
+    static constexpr std::uint64_t inactive_epoch = 0;
+public:
+    /*!
+     * The value type of the N'th template argument.
+     */
+    template <std::size_t i>
+    using value_type = decltype(detail::IndexToType<i, Types...>::value);
+
+    using size_type = std::size_t;
+
+    class Reader;
+
+    /*!
+     * A consistent view of the rows published when it was taken.
+     *
+     * The rows remain valid until the snapshot is destroyed.
+     */
+    class Snapshot
+    {
+        friend class Reader;
+    public:
+        Snapshot(Snapshot const &) = delete;
+        Snapshot & operator=(Snapshot const &) = delete;
+
+        /*!
+         * Destructor. Leaves the epoch, allowing retired memory to be freed.
+         */
+        ~Snapshot()
+        {
+            slot_->epoch.store(inactive_epoch, std::memory_order_release);
+        }
+
+        /*!
+         * Get the number of rows in the snapshot.
+         *
+         * @return The number of rows.
+         */
+        size_type size() const noexcept
+        {
+            return rows_.size();
+        }
+
+        /*!
+         * Get a reference to the element of a certain array at a given index.
+         *
+         * @tparam TypeIndex The index of the array.
+         * @param index The index.
+         * @return A reference to the element at the position.
+         */
+        template<size_type TypeIndex>
+        value_type<TypeIndex> const & get(size_type index) const noexcept
+        {
+            return rows_.template get<TypeIndex>(index);
+        }
+
+        /*!
+         * Get a span over all rows in the snapshot.
+         *
+         * @return The span.
+         */
+        SOASpan<Types const...> rows() const noexcept
+        {
+            return rows_;
+        }
+
+    private:
+        /*!
+         * Enter the current epoch and load the published rows.
+         */
+        Snapshot(SnapshotSOAVector const & vec, ReaderSlot & slot) noexcept:
+            slot_(&slot)
+        {
+            assert(slot.epoch.load(std::memory_order_relaxed) == inactive_epoch);
+            slot.epoch.store(vec.global_epoch_.load());
+
+            // Load the size before the block, so the block is at least as new
+            // as the size and the rows are guaranteed to be in it.
+            size_type const size = vec.size_.load();
+            Block const * const block = vec.block_.load();
+            rows_ = [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+            {
+                return SOASpan<Types const...>(
+                    size, reinterpret_cast<Types const *>(block->array_ptrs[TypeIndices])...);
+            }(std::index_sequence_for<Types...>{});
+        }
+
+        // Member variables:
+        ReaderSlot * slot_;
+        SOASpan<Types const...> rows_;
+    };
+
+    /*!
+     * A registered reader thread, which can take snapshots.
+     *
+     * A reader must only be used by one thread at a time and can hold at most
+     * one snapshot at a time.
+     */
+    class Reader
+    {
+        friend class SnapshotSOAVector;
+    public:
+        Reader(Reader const &) = delete;
+        Reader & operator=(Reader const &) = delete;
+
+        /*!
+         * Move constructor.
+         */
+        Reader(Reader && other) noexcept:
+            vec_(other.vec_),
+            slot_(std::exchange(other.slot_, nullptr))
+        {}
+
+        /*!
+         * Destructor. Unregisters the reader.
+         */
+        ~Reader()
+        {
+            if (slot_ != nullptr)
+            {
+                slot_->in_use.store(false, std::memory_order_release);
+            }
+        }
+
+        /*!
+         * Take a snapshot of the published rows. Wait-free.
+         *
+         * @return The snapshot.
+         */
+        Snapshot snapshot() const noexcept
+        {
+            return Snapshot(*vec_, *slot_);
+        }
+
+    private:
+        Reader(SnapshotSOAVector const & vec, ReaderSlot & slot) noexcept:
+            vec_(&vec),
+            slot_(&slot)
+        {}
+
+        // Member variables:
+        SnapshotSOAVector const * vec_;
+        ReaderSlot * slot_;
+    };
+
+    /*!
+     * Create an empty vector.
+     *
+     * @param max_readers The maximum number of concurrently registered readers.
+     */
+    explicit SnapshotSOAVector(size_type max_readers = 64):
+        reader_slots_(std::make_unique<ReaderSlot[]>(max_readers)),
+        max_readers_(max_readers),
+        block_(new Block{})
+    {}
+
+    SnapshotSOAVector(SnapshotSOAVector const &) = delete;
+    SnapshotSOAVector & operator=(SnapshotSOAVector const &) = delete;
+
+    /*!
+     * Destructor.
+     *
+     * All readers must have been destroyed.
+     */
+    ~SnapshotSOAVector()
+    {
+        for (RetiredBlock const & retired : retired_blocks_)
+        {
+            free_block(retired.block);
+        }
+        free_block(block_.load());
+    }
+
+    /*!
+     * Register a reader.
+     *
+     * @return The reader.
+     * @throws std::length_error if 'max_readers' readers are already registered.
+     */
+    Reader register_reader() const
+    {
+        for (size_type i = 0; i < max_readers_; ++i)
+        {
+            bool expected = false;
+            if (reader_slots_[i].in_use.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+            {
+                return Reader(*this, reader_slots_[i]);
+            }
+        }
+        throw std::length_error("SnapshotSOAVector: too many readers");
+    }
+
+    /*!
+     * Get the number of published rows.
+     *
+     * @return The number of rows.
+     */
+    size_type size() const noexcept
+    {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * Get the capacity of the current memory allocation. Writer only.
+     *
+     * @return The capacity.
+     */
+    size_type capacity() const noexcept
+    {
+        return block_.load(std::memory_order_relaxed)->capacity;
+    }
+
+    /*!
+     * Get a reference to the element of a certain array at a given index.
+     * Writer only.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @param index The index.
+     * @return A reference to the element at the position.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> const & get(size_type index) const noexcept
+    {
+        assert(index < this->size());
+        Block const * const block = block_.load(std::memory_order_relaxed);
+        return *(reinterpret_cast<value_type<TypeIndex> const *>(block->array_ptrs[TypeIndex]) + index);
+    }
+
+    /*!
+     * Adds a set of elements at the end of each array and publishes them.
+     * Writer only.
+     *
+     * @param args The elements to add.
+     */
+    void push_back(Types&&... args)
+    {
+        size_type const size = this->size();
+        if (size + 1 > this->capacity())
+        {
+            this->reserve(size * growth_factor + 1);
+        }
+
+        Block * const block = block_.load(std::memory_order_relaxed);
+        std::size_t type_index = 0;
+        (
+            (
+                new(block->array_ptrs[type_index] + size * sizeof(Types)) Types(std::forward<decltype(args)>(args)),
+                ++type_index
+            ),
+            ...
+        );
+        block->size = size + 1;
+        size_.store(size + 1);
+    }
+
+    /*!
+     * Reserve storage. Writer only.
+     *
+     * The published rows are copied to the new memory allocation, and the old
+     * one is retired until no reader can be using it.
+     *
+     * @param new_capacity The new capacity of the arrays. Will only
+     *      reallocate if 'new_capacity' is larger than the current capacity.
+     */
+    void reserve(size_type new_capacity)
+    {
+        Block * const old_block = block_.load(std::memory_order_relaxed);
+        if (new_capacity <= old_block->capacity)
+        {
+            return;
+        }
+
+        auto const [offsets, total_num_bytes] = Layout::calculate_array_offsets_and_allocation_size(new_capacity);
+        char * const data = static_cast<char *>(
+            ::operator new[](total_num_bytes, std::align_val_t(Layout::allocation_alignment)));
+
+        auto new_block = std::make_unique<Block>();
+        for (std::size_t array_index = 0; array_index < new_block->array_ptrs.size(); ++array_index)
+        {
+            new_block->array_ptrs[array_index] = data + offsets[array_index];
+        }
+        new_block->capacity = new_capacity;
+
+        // Copy rather than move, since readers may still be reading the old elements.
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            (
+                std::uninitialized_copy_n(
+                    reinterpret_cast<Types const *>(old_block->array_ptrs[TypeIndices]),
+                    old_block->size,
+                    reinterpret_cast<Types *>(new_block->array_ptrs[TypeIndices])),
+                ...
+            );
+        }(std::index_sequence_for<Types...>{});
+        new_block->size = old_block->size;
+
+        block_.store(new_block.release());
+        retired_blocks_.push_back(RetiredBlock{old_block, global_epoch_.fetch_add(1)});
+        this->reclaim();
+    }
+
+    /*!
+     * Free retired memory allocations that no reader can be using. Writer only.
+     *
+     * Called automatically when reallocating.
+     *
+     * @return The number of retired allocations still waiting for readers.
+     */
+    size_type reclaim()
+    {
+        std::uint64_t oldest_active_epoch = std::numeric_limits<std::uint64_t>::max();
+        for (size_type i = 0; i < max_readers_; ++i)
+        {
+            std::uint64_t const epoch = reader_slots_[i].epoch.load();
+            if (epoch != inactive_epoch)
+            {
+                oldest_active_epoch = std::min(oldest_active_epoch, epoch);
+            }
+        }
+
+        std::erase_if(retired_blocks_, [oldest_active_epoch](RetiredBlock const & retired)
+        {
+            if (retired.epoch < oldest_active_epoch)
+            {
+                free_block(retired.block);
+                return true;
+            }
+            return false;
+        });
+        return retired_blocks_.size();
+    }
+
+private:
+    using Layout = SOAVector<Types...>;
+
+    /*!
+     * Destroy the elements of a block and free it.
+     */
+    static void free_block(Block * const block) noexcept
+    {
+        if (block->capacity > 0)
+        {
+            [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+            {
+                (std::destroy_n(reinterpret_cast<Types *>(block->array_ptrs[TypeIndices]), block->size), ...);
+            }(std::index_sequence_for<Types...>{});
+            ::operator delete[](block->array_ptrs[0], std::align_val_t(Layout::allocation_alignment));
+        }
+        delete block;
+    }
+
+    // Member variables:
+    std::unique_ptr<ReaderSlot[]> reader_slots_;
+    size_type max_readers_;
+    std::vector<RetiredBlock> retired_blocks_;
+    alignas(detail::cache_line_size) std::atomic<std::uint64_t> global_epoch_{inactive_epoch + 1};
+    std::atomic<Block *> block_;
+    std::atomic<size_type> size_{0};
+    static constexpr float growth_factor = 1.5;
+};
+
+/*!
+ * Bounded ring buffer storing each element type in its own ring.
+ *
+ * All rings share a single memory allocation with the same layout as a
+ * 'SOAVector' of 'Capacity' rows, so a consumer only interested in some of
+ * the fields only touches the memory of those rings.
+ *
+ * Producers and consumers each have a head and a tail index on separate cache
+ * lines. Claiming rows advances the head, and publishing them advances the
+ * tail once all earlier claims are published. In the single producer, single
+ * consumer variant claiming is a plain store; in the multi producer, multi
+ * consumer variant it is a compare-and-swap, and a thread publishing its rows
+ * waits for the threads that claimed rows before it.
+ *
+ * Use the 'SOARingBuffer' and 'MPMCSOARingBuffer' aliases.
+ *
+ * @tparam Capacity The number of rows. Must be a power of two.
+ * @tparam MultiProducerMultiConsumer Whether multiple threads may push and
+ *      multiple threads may pop concurrently.
+ */
+template <std::size_t Capacity, bool MultiProducerMultiConsumer, detail::PlainColumn... Types>
+class BasicSOARingBuffer
+{
+    static_assert(std::has_single_bit(Capacity), "Capacity must be a power of two");
+
+    /*!
+     * Head and tail index of either the producers or the consumers.
+     */
+    struct alignas(detail::cache_line_size) HeadTail
+    {
+        std::atomic<std::size_t> head{0};
+        alignas(detail::cache_line_size) std::atomic<std::size_t> tail{0};
+    };
+public:
+    /*!
+     * The value type of the N'th template argument.
+     */
+    template <std::size_t i>
+    using value_type = decltype(detail::IndexToType<i, Types...>::value);
+
+    using size_type = std::size_t;
+
+    /*!
+     * Create an empty ring buffer.
+     */
+    BasicSOARingBuffer():
+        data_(static_cast<char *>(::operator new[](
+            Layout::calculate_array_offsets_and_allocation_size(Capacity).second,
+            std::align_val_t(Layout::allocation_alignment))))
+    {}
+
+    BasicSOARingBuffer(BasicSOARingBuffer const &) = delete;
+    BasicSOARingBuffer & operator=(BasicSOARingBuffer const &) = delete;
+
+    /*!
+     * Destructor. Destroys any rows not yet popped.
+     */
+    ~BasicSOARingBuffer()
+    {
+        size_type const first = consumer_.tail.load(std::memory_order_relaxed);
+        size_type const last = producer_.tail.load(std::memory_order_relaxed);
+        for_each_contiguous_range(first, last - first, [this](size_type ring_index, size_type count, size_type)
+        {
+            [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+            {
+                (std::destroy_n(this->ring<TypeIndices>() + ring_index, count), ...);
+            }(std::index_sequence_for<Types...>{});
+        });
+        ::operator delete[](data_, std::align_val_t(Layout::allocation_alignment));
+    }
+
+    /*!
+     * Get the maximum number of rows.
+     *
+     * @return The capacity.
+     */
+    static constexpr size_type capacity() noexcept
+    {
+        return Capacity;
+    }
+
+    /*!
+     * Get the number of rows published and not yet claimed by a consumer.
+     *
+     * Only a snapshot if other threads are pushing or popping concurrently.
+     *
+     * @return The number of rows.
+     */
+    size_type size() const noexcept
+    {
+        size_type const consumer_head = consumer_.head.load(std::memory_order_acquire);
+        return producer_.tail.load(std::memory_order_acquire) - consumer_head;
+    }
+
+    /*!
+     * Push a single row.
+     *
+     * @param args The elements of the row.
+     * @return True if the row was pushed, false if the buffer was full.
+     */
+    bool try_push(Types&&... args)
+    {
+        auto const [first, count] = this->claim(producer_, consumer_, Capacity, 1, 1);
+        if (count == 0)
+        {
+            return false;
+        }
+
+        size_type const ring_index = first & (Capacity - 1);
+        std::size_t type_index = 0;
+        (
+            (
+                new(data_ + offsets_[type_index] + ring_index * sizeof(Types)) Types(std::forward<decltype(args)>(args)),
+                ++type_index
+            ),
+            ...
+        );
+
+        this->publish(producer_, first, 1);
+        return true;
+    }
+
+    /*!
+     * Push as many rows of a batch as fit, with a single claim.
+     *
+     * @param rows The rows to copy into the buffer.
+     * @return The number of rows pushed, from the start of 'rows'.
+     */
+    size_type push(SOASpan<Types const...> rows)
+    {
+        auto const [first, count] = this->claim(producer_, consumer_, Capacity, 1, rows.size());
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        for_each_contiguous_range(first, count, [&](size_type ring_index, size_type range_count, size_type offset)
+        {
+            [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+            {
+                (
+                    std::uninitialized_copy_n(
+                        rows.template data<TypeIndices>() + offset,
+                        range_count,
+                        this->ring<TypeIndices>() + ring_index),
+                    ...
+                );
+            }(std::index_sequence_for<Types...>{});
+        });
+
+        this->publish(producer_, first, count);
+        return count;
+    }
+
+    /*!
+     * Consume a batch of rows in place, with a single claim.
+     *
+     * The rows are passed to 'func' as one or two spans (two if the batch
+     * wraps around the end of the rings), and destroyed afterwards.
+     *
+     * @param max_count The maximum number of rows to consume.
+     * @param func The function, called as 'func(SOASpan<Types...>)'.
+     * @return The number of rows consumed.
+     */
+    template <typename Func>
+    size_type consume(size_type max_count, Func && func)
+    {
+        auto const [first, count] = this->claim(consumer_, producer_, 0, 1, max_count);
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        for_each_contiguous_range(first, count, [&](size_type ring_index, size_type range_count, size_type)
+        {
+            [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+            {
+                func(SOASpan<Types...>(range_count, (this->ring<TypeIndices>() + ring_index)...));
+                (std::destroy_n(this->ring<TypeIndices>() + ring_index, range_count), ...);
+            }(std::index_sequence_for<Types...>{});
+        });
+
+        this->publish(consumer_, first, count);
+        return count;
+    }
+
+    /*!
+     * Pop a batch of rows, moving them into existing elements.
+     *
+     * @param out The rows to move the popped elements into.
+     * @return The number of rows popped, written to the start of 'out'.
+     */
+    size_type pop(SOASpan<Types...> out)
+    {
+        size_type offset = 0;
+        return this->consume(out.size(), [&](SOASpan<Types...> rows)
+        {
+            [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+            {
+                (std::move(rows.template data<TypeIndices>(), rows.template data<TypeIndices>() + rows.size(),
+                    out.template data<TypeIndices>() + offset), ...);
+            }(std::index_sequence_for<Types...>{});
+            offset += rows.size();
+        });
+    }
+
+private:
+    using Layout = SOAVector<Types...>;
+
+    /*!
+     * Get a pointer to the start of a ring.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> * ring() const noexcept
+    {
+        return reinterpret_cast<value_type<TypeIndex> *>(data_ + offsets_[TypeIndex]);
+    }
+
+    /*!
+     * Call a function for the one or two contiguous ranges of ring indices
+     * covering a range of rows.
+     *
+     * @param first The index of the first row.
+     * @param count The number of rows.
+     * @param func The function, called as 'func(ring_index, count, offset)'
+     *      where 'offset' is the number of rows before the range.
+     */
+    template <typename Func>
+    static void for_each_contiguous_range(size_type first, size_type count, Func && func)
+    {
+        size_type const ring_index = first & (Capacity - 1);
+        size_type const first_count = std::min(count, Capacity - ring_index);
+        if (first_count > 0)
+        {
+            func(ring_index, first_count, 0);
+        }
+        if (count > first_count)
+        {
+            func(0, count - first_count, first_count);
+        }
+    }
+
+    /*!
+     * Claim a range of rows for producing or consuming.
+     *
+     * @param own The indices of the claiming side.
+     * @param other The indices of the opposite side.
+     * @param other_offset The number of rows the opposite side's tail is
+     *      ahead of the last row available to the claiming side.
+     * @param min_count The minimum number of rows to claim.
+     * @param max_count The maximum number of rows to claim.
+     * @return The index of the first claimed row and the number of rows
+     *      claimed, which is zero if fewer than 'min_count' were available.
+     */
+    static std::pair<size_type, size_type> claim(
+        HeadTail & own, HeadTail const & other, size_type other_offset, size_type min_count, size_type max_count)
+    {
+        size_type head = own.head.load(std::memory_order_relaxed);
+        size_type count;
+        do
+        {
+            size_type const available = other.tail.load(std::memory_order_acquire) + other_offset - head;
+            count = std::min(available, max_count);
+            if (count == 0 || count < min_count)
+            {
+                return {head, 0};
+            }
+            if constexpr (!MultiProducerMultiConsumer)
+            {
+                own.head.store(head + count, std::memory_order_relaxed);
+                break;
+            }
+        }
+        while (!own.head.compare_exchange_weak(head, head + count, std::memory_order_relaxed));
+        return {head, count};
+    }
+
+    /*!
+     * Publish claimed rows once all earlier claims are published.
+     */
+    static void publish(HeadTail & own, size_type first, size_type count) noexcept
+    {
+        if constexpr (MultiProducerMultiConsumer)
+        {
+            // Acquire, so the rows published by earlier claims are visible to
+            // whoever acquires our tail.
+            for (unsigned spin = 0; own.tail.load(std::memory_order_acquire) != first; ++spin)
+            {
+                if (spin > 64)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        own.tail.store(first + count, std::memory_order_release);
+    }
+
+    // Member variables:
+    char * const data_;
+    static constexpr auto offsets_ = Layout::calculate_array_offsets_and_allocation_size(Capacity).first;
+    HeadTail producer_;
+    HeadTail consumer_;
+};
+
+/*!
+ * Single producer, single consumer SOA ring buffer.
+ */
+template <std::size_t Capacity, typename... Types>
+using SOARingBuffer = BasicSOARingBuffer<Capacity, false, Types...>;
+
+/*!
+ * Bounded multi producer, multi consumer SOA ring buffer.
+ */
+template <std::size_t Capacity, typename... Types>
+using MPMCSOARingBuffer = BasicSOARingBuffer<Capacity, true, Types...>;
+
+/*!
+ * Marks a column of a 'DoubleBufferedSOAVector' as constant, storing it only
+ * once instead of in both buffers.
+ */
+template <typename T>
+struct ConstantColumn
+{
+};
+
+namespace detail
+{
+    /*!
+     * Helper struct to get the element type of a possibly constant column.
+     */
+    template <typename T>
+    struct ColumnElement
+    {
+        using type = T;
+        static constexpr bool is_constant = false;
+    };
+
+    template <typename T>
+    struct ColumnElement<ConstantColumn<T>>
+    {
+        using type = T;
+        static constexpr bool is_constant = true;
+    };
+}
+
+/*!
+ * SOA container holding two equally sized sets of arrays, for computing the
+ * next state of a simulation step from the current one.
+ *
+ * The front buffer is read-only and holds the current state, the back buffer
+ * receives the next state. 'swap_buffers()' makes the back buffer the new
+ * front buffer in constant time. Columns declared as 'ConstantColumn<T>' are
+ * stored once, are read-only in both buffers and are not swapped.
+ *
+ * All arrays of both buffers share a single memory allocation and start on a
+ * cache line boundary.
+ */
+template <typename... Columns>
+    requires (detail::PlainColumn<typename detail::ColumnElement<Columns>::type> && ...)
+class DoubleBufferedSOAVector
+{
+    template <typename T>
+    using element_t = typename detail::ColumnElement<T>::type;
+
+    template <typename T>
+    using back_element_t = std::conditional_t<detail::ColumnElement<T>::is_constant, element_t<T> const, element_t<T>>;
+
+    static constexpr std::size_t column_count = sizeof...(Columns);
+public:
+    /*!
+     * The value type of the N'th column.
+     */
+    template <std::size_t i>
+    using value_type = element_t<decltype(detail::IndexToType<i, Columns...>::value)>;
+
+    using size_type = std::size_t;
+
+    /*!
+     * Create a double buffered vector with a given size, default initializing
+     * all elements of both buffers.
+     *
+     * @param size The number of elements.
+     */
+    explicit DoubleBufferedSOAVector(size_type size):
+        size_(size)
+    {
+        auto const [offsets, total_num_bytes] = calculate_array_offsets_and_allocation_size(size);
+        data_ = static_cast<char *>(::operator new[](total_num_bytes, std::align_val_t(allocation_alignment)));
+        offsets_ = offsets;
+
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            (std::uninitialized_value_construct_n(this->array<TypeIndices>(0), size_), ...);
+            (
+                (detail::ColumnElement<Columns>::is_constant
+                    ? void()
+                    : void(std::uninitialized_value_construct_n(this->array<TypeIndices>(1), size_))),
+                ...
+            );
+        }(std::index_sequence_for<Columns...>{});
+    }
+
+    DoubleBufferedSOAVector(DoubleBufferedSOAVector const &) = delete;
+    DoubleBufferedSOAVector & operator=(DoubleBufferedSOAVector const &) = delete;
+
+    /*!
+     * Destructor.
+     */
+    ~DoubleBufferedSOAVector()
+    {
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            (std::destroy_n(this->array<TypeIndices>(0), size_), ...);
+            (
+                (detail::ColumnElement<Columns>::is_constant
+                    ? void()
+                    : void(std::destroy_n(this->array<TypeIndices>(1), size_))),
+                ...
+            );
+        }(std::index_sequence_for<Columns...>{});
+        ::operator delete[](data_, std::align_val_t(allocation_alignment));
+    }
+
+    /*!
+     * Get the size, i.e. number of elements in each array.
+     *
+     * @return The number of elements.
+     */
+    size_type size() const noexcept
+    {
+        return size_;
+    }
+
+    /*!
+     * Get a read-only view of the front buffer, i.e. the current state.
+     *
+     * @return A span over all columns of the front buffer.
+     */
+    SOASpan<element_t<Columns> const...> front_buffer() const noexcept
+    {
+        return [this]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            return SOASpan<element_t<Columns> const...>(size_, this->array<TypeIndices>(front_index_)...);
+        }(std::index_sequence_for<Columns...>{});
+    }
+
+    /*!
+     * Get a view of the back buffer, i.e. the next state to be written.
+     *
+     * Constant columns are read-only in this view as well.
+     *
+     * @return A span over all columns of the back buffer.
+     */
+    SOASpan<back_element_t<Columns>...> back_buffer() noexcept
+    {
+        return [this]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            return SOASpan<back_element_t<Columns>...>(size_, this->array<TypeIndices>(1 - front_index_)...);
+        }(std::index_sequence_for<Columns...>{});
+    }
+
+    /*!
+     * Get a mutable span over a constant column, e.g. to initialize it.
+     *
+     * @tparam TypeIndex The index of the column, which must be constant.
+     * @return A span over the elements of the column.
+     */
+    template<size_type TypeIndex>
+    std::span<value_type<TypeIndex>> constant_column() noexcept
+    {
+        static_assert(detail::ColumnElement<decltype(detail::IndexToType<TypeIndex, Columns...>::value)>::is_constant,
+            "Column is not constant");
+        return std::span<value_type<TypeIndex>>(this->array<TypeIndex>(0), size_);
+    }
+
+    /*!
+     * Swap the front and back buffers, making the state written to the back
+     * buffer the current state.
+     *
+     * Invalidates all views of the buffers.
+     */
+    void swap_buffers() noexcept
+    {
+        front_index_ = 1 - front_index_;
+    }
+
+private:
+    /*!
+     * Get a pointer to the array of a column in one of the buffers.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> * array(size_type buffer_index) const noexcept
+    {
+        if (detail::ColumnElement<decltype(detail::IndexToType<TypeIndex, Columns...>::value)>::is_constant)
+        {
+            buffer_index = 0;
+        }
+        return reinterpret_cast<value_type<TypeIndex> *>(data_ + offsets_[buffer_index * column_count + TypeIndex]);
+    }
+
+    /*!
+     * Calculate the offsets of the arrays of both buffers and the total
+     * required memory allocation size.
+     *
+     * @param element_count The number of elements in each array.
+     * @return An array with the offsets of the arrays of the first buffer
+     *      followed by those of the second buffer, where constant columns
+     *      share the offset of the first buffer, and the required memory
+     *      allocation size.
+     */
+    static constexpr std::pair<std::array<ptrdiff_t, 2 * column_count>, size_t>
+    calculate_array_offsets_and_allocation_size(size_type element_count)
+    {
+        const auto sizes = std::array{(sizeof(element_t<Columns>) * element_count)...};
+        const auto alignments = std::array{std::max(alignof(element_t<Columns>), detail::cache_line_size)...};
+        const auto is_constant = std::array{detail::ColumnElement<Columns>::is_constant...};
+
+        std::array<ptrdiff_t, 2 * column_count> offsets{};
+        ptrdiff_t p = 0;
+        for (size_type i = 0; i < 2 * column_count; ++i)
+        {
+            size_type const column = i % column_count;
+            if (i >= column_count && is_constant[column])
+            {
+                offsets[i] = offsets[column];
+                continue;
+            }
+            p = (p + alignments[column] - 1) / alignments[column] * alignments[column];
+            offsets[i] = p;
+            p += sizes[column];
+        }
+
+        return {offsets, p};
+    }
+
+    // Member variables:
+    char * data_;
+    std::array<ptrdiff_t, 2 * column_count> offsets_;
+    size_type size_;
+    size_type front_index_ = 0;
+    static constexpr std::size_t allocation_alignment =
+        std::max({detail::cache_line_size, alignof(element_t<Columns>)...});
+};
+
+/*!
+ * A set of column indices accessed for reading.
+ */
+template <std::size_t... TypeIndices>
+struct ReadColumns
+{
+};
+
+/*!
+ * A set of column indices accessed for writing.
+ */
+template <std::size_t... TypeIndices>
+struct WriteColumns
+{
+};
+
+/*!
+ * Declares the columns read by an operation, e.g. 'reads<0, 2>'.
+ */
+template <std::size_t... TypeIndices>
+inline constexpr ReadColumns<TypeIndices...> reads{};
+
+/*!
+ * Declares the columns written by an operation, e.g. 'writes<1>'.
+ */
+template <std::size_t... TypeIndices>
+inline constexpr WriteColumns<TypeIndices...> writes{};
+
+/*!
+ * SOA vector with a reader/writer lock per column, so that threads updating
+ * different columns do not serialize each other.
+ *
+ * Accessing columns takes the structural lock in shared mode and then the
+ * lock of each accessed column, in shared mode for reading and exclusive mode
+ * for writing. Operations changing the number of rows or the memory
+ * allocation take the structural lock in exclusive mode. Locks are always
+ * taken in the same order, structural lock first and then columns by
+ * increasing index, so accesses cannot deadlock.
+ */
+template <detail::PlainColumn... Types>
+class ConcurrentSOAVector
+{
+    /*!
+     * A lock on its own cache line, to avoid false sharing between columns.
+     */
+    struct alignas(detail::cache_line_size) Lock
+    {
+        std::shared_mutex mutex;
+    };
+public:
+    /*!
+     * The value type of the N'th template argument.
+     */
+    template <std::size_t i>
+    using value_type = decltype(detail::IndexToType<i, Types...>::value);
+
+    using size_type = std::size_t;
+
+    /*!
+     * Default constructor.
+     *
+     * Creates an empty vector.
+     */
+    ConcurrentSOAVector() = default;
+
+    /*!
+     * Create a vector taking over the rows of a SOA vector.
+     *
+     * @param vec The vector to take over.
+     */
+    explicit ConcurrentSOAVector(SOAVector<Types...> && vec):
+        vec_(std::move(vec))
+    {}
+
+    ConcurrentSOAVector(ConcurrentSOAVector const &) = delete;
+    ConcurrentSOAVector & operator=(ConcurrentSOAVector const &) = delete;
+
+    /*!
+     * Get the size, i.e. number of elements in the vector.
+     *
+     * @return The number of elements.
+     */
+    size_type size() const
+    {
+        std::shared_lock lock(structure_lock_.mutex);
+        return vec_.size();
+    }
+
+    /*!
+     * Adds a set of elements at the end of each array.
+     *
+     * @param args The elements to add.
+     */
+    void push_back(Types&&... args)
+    {
+        std::unique_lock lock(structure_lock_.mutex);
+        vec_.push_back(std::forward<Types>(args)...);
+    }
+
+    /*!
+     * Remove the last element of each array.
+     */
+    void pop_back()
+    {
+        std::unique_lock lock(structure_lock_.mutex);
+        vec_.pop_back();
+    }
+
+    /*!
+     * Reserve storage.
+     *
+     * @param new_capacity The new capacity of the arrays.
+     */
+    void reserve(size_type new_capacity)
+    {
+        std::unique_lock lock(structure_lock_.mutex);
+        vec_.reserve(new_capacity);
+    }
+
+    /*!
+     * Call a function with spans over some columns, holding their locks.
+     *
+     * @param func The function, called with a 'std::span<T const>' for each
+     *      column in 'ReadIndices', followed by a 'std::span<T>' for each
+     *      column in 'WriteIndices'. The spans must not be used after it
+     *      returns.
+     * @return The return value of 'func'.
+     */
+    template <std::size_t... ReadIndices, std::size_t... WriteIndices, typename Func>
+    decltype(auto) access(ReadColumns<ReadIndices...>, WriteColumns<WriteIndices...>, Func && func)
+    {
+        static_assert(((ReadIndices < sizeof...(Types)) && ...) && ((WriteIndices < sizeof...(Types)) && ...),
+            "Index out of bounds");
+        static_assert((column_mask<ReadIndices...>() & column_mask<WriteIndices...>()) == 0,
+            "A column cannot be both read and written");
+
+        std::shared_lock structure_lock(structure_lock_.mutex);
+        ColumnLockGuard const column_locks(
+            column_locks_,
+            column_mask<ReadIndices...>(),
+            column_mask<WriteIndices...>());
+        return func(
+            std::as_const(vec_).template span<ReadIndices>()...,
+            vec_.template span<WriteIndices>()...);
+    }
+
+    /*!
+     * Call a function with read-only spans over some columns.
+     *
+     * @tparam ReadIndices The indices of the columns.
+     * @param func The function, called with a 'std::span<T const>' for each column.
+     * @return The return value of 'func'.
+     */
+    template <std::size_t... ReadIndices, typename Func>
+    decltype(auto) read(Func && func)
+    {
+        return this->access(reads<ReadIndices...>, writes<>, std::forward<Func>(func));
+    }
+
+    /*!
+     * Call a function with mutable spans over some columns.
+     *
+     * @tparam WriteIndices The indices of the columns.
+     * @param func The function, called with a 'std::span<T>' for each column.
+     * @return The return value of 'func'.
+     */
+    template <std::size_t... WriteIndices, typename Func>
+    decltype(auto) write(Func && func)
+    {
+        return this->access(reads<>, writes<WriteIndices...>, std::forward<Func>(func));
+    }
+
+    /*!
+     * Call a function with exclusive access to the whole underlying vector.
+     *
+     * @param func The function, called as 'func(SOAVector<Types...> &)'.
+     * @return The return value of 'func'.
+     */
+    template <typename Func>
+    decltype(auto) exclusive(Func && func)
+    {
+        std::unique_lock lock(structure_lock_.mutex);
+        return func(vec_);
+    }
+
+private:
+    /*!
+     * Locks a set of columns in index order and unlocks them in reverse.
+     */
+    class ColumnLockGuard
+    {
+    public:
+        ColumnLockGuard(std::array<Lock, sizeof...(Types)> & locks, std::uint64_t read_mask, std::uint64_t write_mask):
+            locks_(locks),
+            read_mask_(read_mask),
+            write_mask_(write_mask)
+        {
+            for (size_type i = 0; i < locks_.size(); ++i)
+            {
+                if (write_mask_ & (std::uint64_t{1} << i))
+                {
+                    locks_[i].mutex.lock();
+                }
+                else if (read_mask_ & (std::uint64_t{1} << i))
+                {
+                    locks_[i].mutex.lock_shared();
+                }
+            }
+        }
+
+        ColumnLockGuard(ColumnLockGuard const &) = delete;
+        ColumnLockGuard & operator=(ColumnLockGuard const &) = delete;
+
+        ~ColumnLockGuard()
+        {
+            for (size_type i = locks_.size(); i-- > 0;)
+            {
+                if (write_mask_ & (std::uint64_t{1} << i))
+                {
+                    locks_[i].mutex.unlock();
+                }
+                else if (read_mask_ & (std::uint64_t{1} << i))
+                {
+                    locks_[i].mutex.unlock_shared();
+                }
+            }
+        }
+
+    private:
+        std::array<Lock, sizeof...(Types)> & locks_;
+        std::uint64_t read_mask_;
+        std::uint64_t write_mask_;
+    };
+
+    /*!
+     * Get a bit mask with the bits of the given column indices set.
+     */
+    template <std::size_t... TypeIndices>
+    static constexpr std::uint64_t column_mask() noexcept
+    {
+        return (std::uint64_t{0} | ... | (std::uint64_t{1} << TypeIndices));
+    }
+
+    static_assert(sizeof...(Types) <= 64, "At most 64 columns are supported");
+
+    // Member variables:
+    SOAVector<Types...> vec_;
+    mutable Lock structure_lock_;
+    std::array<Lock, sizeof...(Types)> column_locks_;
+};
+
+/*!
+ * Runs kernels operating on columns of SOA vectors on a pool of threads,
+ * ordered by the columns they access.
+ *
+ * The worker threads are started by the first 'run()' that needs them and
+ * wait for the next 'run()' in between, so running a frame of kernels does
+ * not create threads.
+ *
+ * Each kernel declares the columns it reads and writes at compile time. A
+ * kernel depends on every earlier added kernel that writes a column it reads
+ * or writes, or reads a column it writes, in the same vector. Kernels without
+ * a dependency path between them run concurrently.
+ *
+ * Kernels must not change the number of rows or the memory allocation of
+ * any vector.
+ */
+class KernelScheduler
+{
+    /*!
+     * A kernel and its place in the dependency graph.
+     */
+    struct Kernel
+    {
+        std::string name;
+        std::function<void()> run;
+        void const * vector;
+        std::uint64_t read_mask;
+        std::uint64_t write_mask;
+        std::vector<std::size_t> dependencies;
+        std::vector<std::size_t> dependents;
+
+        // Recorded by the last 'run()':
+        std::size_t thread_index = 0;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+    };
+public:
+    KernelScheduler() = default;
+
+    KernelScheduler(KernelScheduler const &) = delete;
+    KernelScheduler & operator=(KernelScheduler const &) = delete;
+
+    /*!
+     * Destructor. Stops and joins the worker threads.
+     */
+    ~KernelScheduler()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        ready_changed_.notify_all();
+        for (std::thread & worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    /*!
+     * Add a kernel.
+     *
+     * @param name The name of the kernel, used in the trace.
+     * @param vec The vector the kernel operates on.
+     * @param func The kernel, called with a 'std::span<T const>' for each
+     *      column in 'ReadIndices', followed by a 'std::span<T>' for each
+     *      column in 'WriteIndices'.
+     */
+    template <typename... Types, std::size_t... ReadIndices, std::size_t... WriteIndices, typename Func>
+    void add(
+        std::string name,
+        SOAVector<Types...> & vec,
+        ReadColumns<ReadIndices...>,
+        WriteColumns<WriteIndices...>,
+        Func && func)
+    {
+        static_assert(sizeof...(Types) <= 64, "At most 64 columns are supported");
+
+        Kernel kernel;
+        kernel.name = std::move(name);
+        kernel.run = [&vec, func = std::forward<Func>(func)]() mutable
+        {
+            func(std::as_const(vec).template span<ReadIndices>()..., vec.template span<WriteIndices>()...);
+        };
+        kernel.vector = &vec;
+        kernel.read_mask = (std::uint64_t{0} | ... | (std::uint64_t{1} << ReadIndices));
+        kernel.write_mask = (std::uint64_t{0} | ... | (std::uint64_t{1} << WriteIndices));
+
+        std::size_t const index = kernels_.size();
+        for (std::size_t other_index = 0; other_index < index; ++other_index)
+        {
+            Kernel & other = kernels_[other_index];
+            bool const conflicts = other.vector == kernel.vector
+                && ((kernel.write_mask & (other.read_mask | other.write_mask)) != 0
+                    || (kernel.read_mask & other.write_mask) != 0);
+            if (conflicts)
+            {
+                kernel.dependencies.push_back(other_index);
+                other.dependents.push_back(index);
+            }
+        }
+        kernels_.push_back(std::move(kernel));
+    }
+
+    /*!
+     * Get the number of kernels.
+     *
+     * @return The number of kernels.
+     */
+    std::size_t size() const noexcept
+    {
+        return kernels_.size();
+    }
+
+    /*!
+     * Remove all kernels.
+     */
+    void clear() noexcept
+    {
+        kernels_.clear();
+    }
+
+    /*!
+     * Run all kernels once and wait for them to finish.
+     *
+     * The calling thread runs kernels too. Worker threads missing for
+     * 'thread_count' are started and kept for later runs; workers beyond it
+     * stay idle.
+     *
+     * If a kernel throws, its dependents still run, and the first exception
+     * is rethrown once all kernels have finished.
+     *
+     * @param thread_count The number of threads to run kernels on,
+     *      including the calling thread.
+     */
+    void run(std::size_t thread_count)
+    {
+        assert(thread_count > 0);
+
+        std::unique_lock lock(mutex_);
+        remaining_dependencies_.resize(kernels_.size());
+        ready_.clear();
+        for (std::size_t i = 0; i < kernels_.size(); ++i)
+        {
+            remaining_dependencies_[i] = kernels_[i].dependencies.size();
+            if (remaining_dependencies_[i] == 0)
+            {
+                ready_.push_back(i);
+            }
+        }
+        // Run kernels in the order they were added when possible.
+        std::reverse(ready_.begin(), ready_.end());
+
+        kernel_count_ = kernels_.size();
+        finished_ = 0;
+        active_thread_count_ = thread_count;
+        run_start_ = std::chrono::steady_clock::now();
+        while (workers_.size() + 1 < thread_count)
+        {
+            workers_.emplace_back(&KernelScheduler::work, this, workers_.size() + 1);
+        }
+        ready_changed_.notify_all();
+
+        this->run_ready_kernels(lock, 0);
+
+        std::exception_ptr const exception = std::exchange(exception_, nullptr);
+        lock.unlock();
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    /*!
+     * Write the dependency graph and the schedule of the last 'run()'.
+     *
+     * Writes one line per kernel with its name, the thread it ran on, its
+     * start and end time in microseconds relative to the start of the run,
+     * and the kernels it waited for.
+     *
+     * @param os The stream to write to.
+     */
+    void trace(std::ostream & os) const
+    {
+        for (Kernel const & kernel : kernels_)
+        {
+            os << kernel.name
+               << ": thread=" << kernel.thread_index
+               << " start=" << std::chrono::duration_cast<std::chrono::microseconds>(kernel.start - run_start_).count()
+               << "us end=" << std::chrono::duration_cast<std::chrono::microseconds>(kernel.end - run_start_).count()
+               << "us after=[";
+            for (std::size_t i = 0; i < kernel.dependencies.size(); ++i)
+            {
+                os << (i > 0 ? ", " : "") << kernels_[kernel.dependencies[i]].name;
+            }
+            os << "]\n";
+        }
+    }
+
+private:
+    /*!
+     * The loop of a worker thread: wait for a run to have ready kernels and
+     * help run it, until the scheduler is destroyed.
+     *
+     * @param thread_index The index of the worker, starting at 1.
+     */
+    void work(std::size_t thread_index)
+    {
+        std::unique_lock lock(mutex_);
+        while (true)
+        {
+            ready_changed_.wait(lock, [&]
+            {
+                return stopping_ || (thread_index < active_thread_count_ && !ready_.empty());
+            });
+            if (stopping_)
+            {
+                return;
+            }
+            this->run_ready_kernels(lock, thread_index);
+        }
+    }
+
+    /*!
+     * Take kernels from the ready queue and run them, until all kernels of
+     * the current run have finished.
+     *
+     * @param lock The lock of 'mutex_', held on entry and on return.
+     * @param thread_index The index of the calling thread, for the trace.
+     */
+    void run_ready_kernels(std::unique_lock<std::mutex> & lock, std::size_t thread_index)
+    {
+        while (true)
+        {
+            ready_changed_.wait(lock, [&] { return !ready_.empty() || finished_ == kernel_count_; });
+            // A worker beyond the thread count of this run leaves it.
+            if (ready_.empty() || thread_index >= active_thread_count_)
+            {
+                return;
+            }
+            std::size_t const index = ready_.back();
+            ready_.pop_back();
+            Kernel & kernel = kernels_[index];
+
+            lock.unlock();
+            std::exception_ptr exception;
+            kernel.thread_index = thread_index;
+            kernel.start = std::chrono::steady_clock::now();
+            try
+            {
+                kernel.run();
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+            kernel.end = std::chrono::steady_clock::now();
+            lock.lock();
+
+            if (exception && !exception_)
+            {
+                exception_ = exception;
+            }
+            ++finished_;
+            for (std::size_t dependent : kernel.dependents)
+            {
+                if (--remaining_dependencies_[dependent] == 0)
+                {
+                    ready_.push_back(dependent);
+                }
+            }
+            ready_changed_.notify_all();
+        }
+    }
+
+    // Member variables:
+    std::vector<Kernel> kernels_;
+    std::chrono::steady_clock::time_point run_start_;
+    std::vector<std::thread> workers_;
+
+    // State of the current run, guarded by 'mutex_':
+    std::mutex mutex_;
+    std::condition_variable ready_changed_;
+    std::vector<std::size_t> remaining_dependencies_;
+    std::vector<std::size_t> ready_;
+    std::size_t kernel_count_ = 0;
+    std::size_t finished_ = 0;
+    std::size_t active_thread_count_ = 0;
+    std::exception_ptr exception_;
+    bool stopping_ = false;
+};
+
+/*!
+ * SOA table partitioned into a fixed number of independent SOA vectors by a
+ * hash of a key column, so that rows with different keys can be ingested in
+ * parallel.
+ *
+ * Each shard has its own lock on its own cache line. 'push_back()' only
+ * locks the shard the row belongs to. A shard can also be owned by a single
+ * thread and accessed through 'shard()' without locking.
+ *
+ * @tparam Shards The number of shards.
+ * @tparam KeyIndex The index of the key column, hashed with 'std::hash'.
+ */
+template <std::size_t Shards, std::size_t KeyIndex, detail::PlainColumn... Types>
+class ShardedSOAVector
+{
+    static_assert(Shards > 0, "At least one shard is required");
+
+    /*!
+     * A shard and its lock, on their own cache lines.
+     */
+    struct alignas(detail::cache_line_size) Shard
+    {
+        std::mutex mutex;
+        SOAVector<Types...> vec;
+    };
+public:
+    /*!
+     * The value type of the N'th template argument.
+     */
+    template <std::size_t i>
+    using value_type = decltype(detail::IndexToType<i, Types...>::value);
+
+    using size_type = std::size_t;
+    using key_type = value_type<KeyIndex>;
+
+    /*!
+     * Identifies a row by its shard and index within the shard.
+     */
+    struct RowId
+    {
+        size_type shard;
+        size_type row;
+    };
+
+    /*!
+     * Get the shard a key belongs to.
+     *
+     * @param key The key.
+     * @return The index of the shard.
+     */
+    static size_type shard_of(key_type const & key) noexcept
+    {
+        // Mix the hash, since 'std::hash' is the identity for integers.
+        std::uint64_t const hash = static_cast<std::uint64_t>(std::hash<key_type>{}(key)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_type>((hash >> 32) % Shards);
+    }
+
+    /*!
+     * Get the number of shards.
+     *
+     * @return The number of shards.
+     */
+    static constexpr size_type shard_count() noexcept
+    {
+        return Shards;
+    }
+
+    /*!
+     * Get the total number of rows in all shards.
+     *
+     * Locks each shard in turn.
+     *
+     * @return The number of rows.
+     */
+    size_type size() const
+    {
+        size_type size = 0;
+        for (Shard & shard : shards_)
+        {
+            std::lock_guard lock(shard.mutex);
+            size += shard.vec.size();
+        }
+        return size;
+    }
+
+    /*!
+     * Adds a row to the shard of its key.
+     *
+     * Safe to call concurrently from several threads.
+     *
+     * @param args The elements of the row.
+     * @return The id of the added row.
+     */
+    RowId push_back(Types&&... args)
+    {
+        size_type const shard_index = shard_of(std::get<KeyIndex>(std::forward_as_tuple(args...)));
+        Shard & shard = shards_[shard_index];
+        std::lock_guard lock(shard.mutex);
+        shard.vec.push_back(std::forward<Types>(args)...);
+        return RowId{shard_index, shard.vec.size() - 1};
+    }
+
+    /*!
+     * Get a shard without locking it.
+     *
+     * For shards owned by a single thread, or when no other thread is
+     * accessing the table.
+     *
+     * @param shard_index The index of the shard.
+     * @return The vector of the shard.
+     */
+    SOAVector<Types...> & shard(size_type shard_index) noexcept
+    {
+        assert(shard_index < Shards);
+        return shards_[shard_index].vec;
+    }
+
+    /*!
+     * Get a shard without locking it.
+     *
+     * @param shard_index The index of the shard.
+     * @return The vector of the shard.
+     */
+    SOAVector<Types...> const & shard(size_type shard_index) const noexcept
+    {
+        assert(shard_index < Shards);
+        return shards_[shard_index].vec;
+    }
+
+    /*!
+     * Call a function with a shard while holding its lock.
+     *
+     * @param shard_index The index of the shard.
+     * @param func The function, called as 'func(SOAVector<Types...> &)'.
+     * @return The return value of 'func'.
+     */
+    template <typename Func>
+    decltype(auto) with_shard(size_type shard_index, Func && func)
+    {
+        assert(shard_index < Shards);
+        Shard & shard = shards_[shard_index];
+        std::lock_guard lock(shard.mutex);
+        return func(shard.vec);
+    }
+
+    /*!
+     * Call a function with the rows of each shard, locking one shard at a time.
+     *
+     * @param func The function, called as
+     *      'func(size_type shard_index, SOASpan<Types const...> rows)'.
+     */
+    template <typename Func>
+    void scan(Func && func) const
+    {
+        for (size_type shard_index = 0; shard_index < Shards; ++shard_index)
+        {
+            Shard & shard = shards_[shard_index];
+            std::lock_guard lock(shard.mutex);
+            func(shard_index, SOASpan<Types const...>(std::as_const(shard.vec)));
+        }
+    }
+
+    /*!
+     * Get all rows with a given key.
+     *
+     * Only searches the shard of the key.
+     *
+     * @param key The key.
+     * @return The ids of the rows with the key.
+     */
+    std::vector<RowId> find(key_type const & key) const
+    {
+        size_type const shard_index = shard_of(key);
+        Shard & shard = shards_[shard_index];
+        std::lock_guard lock(shard.mutex);
+
+        std::vector<RowId> rows;
+        auto const keys = std::as_const(shard.vec).template span<KeyIndex>();
+        for (size_type row = 0; row < keys.size(); ++row)
+        {
+            if (keys[row] == key)
+            {
+                rows.push_back(RowId{shard_index, row});
+            }
+        }
+        return rows;
+    }
+
+    /*!
+     * Copy a set of rows from any shards into a single vector.
+     *
+     * @param row_ids The ids of the rows, in the order they should be copied.
+     * @return A vector with the rows.
+     */
+    SOAVector<Types...> gather(std::span<RowId const> row_ids) const
+    {
+        SOAVector<Types...> result;
+        result.reserve(row_ids.size());
+        for (RowId const & row_id : row_ids)
+        {
+            assert(row_id.shard < Shards);
+            Shard & shard = shards_[row_id.shard];
+            std::lock_guard lock(shard.mutex);
+            result.append(std::as_const(shard.vec).slice(row_id.row, 1));
+        }
+        return result;
+    }
+
+    /*!
+     * Copy the rows of all shards into a single vector, shard by shard.
+     *
+     * @return A vector with all rows.
+     */
+    SOAVector<Types...> merge() const
+    {
+        SOAVector<Types...> result;
+        result.reserve(this->size());
+        this->scan([&result](size_type, SOASpan<Types const...> rows)
+        {
+            result.append(rows);
+        });
+        return result;
+    }
+
+private:
+    // Member variables:
+    mutable std::array<Shard, Shards> shards_;
+};
+
+/*!
+ * Buffers rows appended by one thread and adds them to a shared SOA vector
+ * in batches.
+ *
+ * Each writing thread creates its own appender for the shared target. Rows
+ * are appended to a small private buffer that stays in the thread's cache,
+ * and moved to the target with a single capacity check and one bulk move
+ * per array when the buffer is full, on 'flush()' or on destruction. The
+ * target's mutex is only taken for flushing.
+ */
+template <detail::PlainColumn... Types>
+class SOAAppender
+{
+public:
+    using size_type = std::size_t;
+
+    /*!
+     * Create an appender for a target vector.
+     *
+     * @param target The vector to add rows to.
+     * @param target_mutex The mutex guarding 'target' between threads.
+     * @param batch_size The number of rows to buffer before flushing.
+     */
+    SOAAppender(SOAVector<Types...> & target, std::mutex & target_mutex, size_type batch_size = 1024):
+        target_(target),
+        target_mutex_(target_mutex),
+        batch_size_(batch_size)
+    {
+        assert(batch_size_ > 0);
+        buffer_.reserve(batch_size_);
+    }
+
+    SOAAppender(SOAAppender const &) = delete;
+    SOAAppender & operator=(SOAAppender const &) = delete;
+
+    /*!
+     * Destructor. Flushes the remaining rows.
+     *
+     * If flushing throws, e.g. because the target cannot grow, the error is
+     * swallowed and the buffered rows are lost. Call 'flush()' before the
+     * appender is destroyed to handle the error.
+     */
+    ~SOAAppender()
+    {
+        try
+        {
+            this->flush();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    /*!
+     * Get the number of buffered rows not yet added to the target.
+     *
+     * @return The number of buffered rows.
+     */
+    size_type buffered() const noexcept
+    {
+        return buffer_.size();
+    }
+
+    /*!
+     * Adds a row to the buffer, flushing it if it is full.
+     *
+     * @param args The elements of the row.
+     */
+    void push_back(Types&&... args)
+    {
+        buffer_.push_back(std::forward<Types>(args)...);
+        if (buffer_.size() >= batch_size_)
+        {
+            this->flush();
+        }
+    }
+
+    /*!
+     * Move all buffered rows to the target.
+     *
+     * @throws std::bad_alloc if the target cannot grow. The rows stay
+     *      buffered.
+     */
+    void flush()
+    {
+        if (buffer_.empty())
+        {
+            return;
+        }
+        std::lock_guard lock(target_mutex_);
+        target_.append(std::move(buffer_));
+    }
+
+private:
+    // Member variables:
+    SOAVector<Types...> & target_;
+    std::mutex & target_mutex_;
+    size_type batch_size_;
+    SOAVector<Types...> buffer_;
+};
+
+/*!
+ * Tags identifying the element type of a column in a serialized SOA table.
+ */
+enum class ColumnTypeTag : std::uint32_t
+{
+    opaque = 0,
+    int8 = 1,
+    int16 = 2,
+    int32 = 3,
+    int64 = 4,
+    uint8 = 5,
+    uint16 = 6,
+    uint32 = 7,
+    uint64 = 8,
+    float32 = 9,
+    float64 = 10,
+    boolean = 11,
+    string = 12,
+};
+
+namespace detail
+{
+    /*!
+     * Get the type tag of a column element type. Trivially copyable types
+     * without a specific tag are stored as 'opaque' bytes.
+     */
+    template <typename T>
+    constexpr ColumnTypeTag column_type_tag() noexcept
+    {
+        if constexpr (std::is_same_v<T, std::string>) return ColumnTypeTag::string;
+        else if constexpr (std::is_same_v<T, bool>) return ColumnTypeTag::boolean;
+        else if constexpr (std::is_same_v<T, float>) return ColumnTypeTag::float32;
+        else if constexpr (std::is_same_v<T, double>) return ColumnTypeTag::float64;
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 1) return ColumnTypeTag::int8;
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 2) return ColumnTypeTag::int16;
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 4) return ColumnTypeTag::int32;
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 8) return ColumnTypeTag::int64;
+        else if constexpr (std::is_integral_v<T> && sizeof(T) == 1) return ColumnTypeTag::uint8;
+        else if constexpr (std::is_integral_v<T> && sizeof(T) == 2) return ColumnTypeTag::uint16;
+        else if constexpr (std::is_integral_v<T> && sizeof(T) == 4) return ColumnTypeTag::uint32;
+        else if constexpr (std::is_integral_v<T> && sizeof(T) == 8) return ColumnTypeTag::uint64;
+        else
+        {
+            static_assert(std::is_trivially_copyable_v<T> && is_plain_column<T>, "Column type cannot be serialized");
+            return ColumnTypeTag::opaque;
+        }
+    }
+
+    /*!
+     * Whether a column type is serialized as its raw bytes.
+     */
+    template <typename T>
+    inline constexpr bool is_raw_column = column_type_tag<T>() != ColumnTypeTag::string;
+
+    /*!
+     * Header at the start of a memory mapped SOA vector, describing the
+     * schema and the layout of the arrays that follow it.
+     */
+    struct MappedHeader
+    {
+        static constexpr std::array<char, 8> expected_magic{'S', 'O', 'A', 'M', 'A', 'P', '\0', '\0'};
+        static constexpr std::uint32_t current_version = 2;
+        static constexpr std::uint32_t native_byte_order = 0x01020304;
+        static constexpr std::size_t max_columns = 64;
+
+        /*!
+         * The offset of the first array from the start of the file. A page
+         * boundary, so the arrays are at least as aligned as in a 'SOAVector'.
+         */
+        static constexpr std::uint64_t data_offset = 4096;
+
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint32_t column_count;
+        std::uint32_t reserved;
+        std::uint64_t size;
+        std::uint64_t capacity;
+        std::array<ColumnTypeTag, max_columns> type_tags;
+        std::array<std::uint32_t, max_columns> element_sizes;
+        std::array<std::uint32_t, max_columns> element_alignments;
+        std::array<std::uint64_t, max_columns> offsets;
+    };
+
+    static_assert(sizeof(MappedHeader) <= MappedHeader::data_offset);
+
+    /*!
+     * Reading and writing the header of a memory mapped SOA vector of
+     * specific types.
+     */
+    template <typename... Types>
+    struct MappedSchema
+    {
+        static_assert((std::is_trivially_copyable_v<Types> && ...),
+            "Memory mapped arrays must be trivially copyable");
+        static_assert((is_plain_column<Types> && ...), "Memory mapped arrays cannot hold ArenaString, PackedBool or Nullable columns");
+        static_assert(sizeof...(Types) <= MappedHeader::max_columns, "Too many columns");
+
+        using Layout = SOAVector<Types...>;
+
+        /*!
+         * Get the file size needed for a given capacity.
+         */
+        static std::uint64_t file_size(std::size_t capacity) noexcept
+        {
+            return MappedHeader::data_offset + Layout::calculate_array_offsets_and_allocation_size(capacity).second;
+        }
+
+        /*!
+         * Initialize a header for an empty vector of a given capacity.
+         */
+        static void initialize(MappedHeader & header, std::size_t capacity) noexcept
+        {
+            header = MappedHeader{};
+            header.magic = MappedHeader::expected_magic;
+            header.version = MappedHeader::current_version;
+            header.byte_order = MappedHeader::native_byte_order;
+            header.column_count = sizeof...(Types);
+            header.size = 0;
+            std::size_t type_index = 0;
+            ((header.type_tags[type_index] = column_type_tag<Types>(),
+              header.element_sizes[type_index] = sizeof(Types),
+              header.element_alignments[type_index] = alignof(Types),
+              ++type_index), ...);
+            set_capacity(header, capacity);
+        }
+
+        /*!
+         * Set the capacity and array offsets of a header.
+         */
+        static void set_capacity(MappedHeader & header, std::size_t capacity) noexcept
+        {
+            auto const offsets = Layout::calculate_array_offsets_and_allocation_size(capacity).first;
+            for (std::size_t i = 0; i < offsets.size(); ++i)
+            {
+                header.offsets[i] = MappedHeader::data_offset + offsets[i];
+            }
+            header.capacity = capacity;
+        }
+
+        /*!
+         * Check that a header describes a vector of these types.
+         *
+         * @param header The header.
+         * @param file_size The size of the file or memory the header is in.
+         * @throws std::runtime_error if it does not.
+         */
+        static void validate(MappedHeader const & header, std::uint64_t file_size)
+        {
+            if (file_size < sizeof(MappedHeader) || header.magic != MappedHeader::expected_magic)
+            {
+                throw std::runtime_error("Not a memory mapped SOA vector");
+            }
+            if (header.version != MappedHeader::current_version)
+            {
+                throw std::runtime_error("Unsupported memory mapped SOA vector version");
+            }
+            if (header.byte_order != MappedHeader::native_byte_order)
+            {
+                throw std::runtime_error("Memory mapped SOA vector has a different byte order");
+            }
+
+            // Compare the type tags as well as the sizes, so that for example
+            // an 'int32_t' column is not read as a 'float' column.
+            bool matches = header.column_count == sizeof...(Types);
+            std::size_t type_index = 0;
+            ((matches = matches
+                && header.type_tags[type_index] == column_type_tag<Types>()
+                && header.element_sizes[type_index] == sizeof(Types)
+                && header.element_alignments[type_index] == alignof(Types),
+              ++type_index), ...);
+            if (!matches)
+            {
+                throw std::runtime_error("Memory mapped SOA vector has a different schema");
+            }
+
+            auto const offsets = Layout::calculate_array_offsets_and_allocation_size(header.capacity).first;
+            for (std::size_t i = 0; i < offsets.size(); ++i)
+            {
+                matches = matches && header.offsets[i] == MappedHeader::data_offset + offsets[i];
+            }
+            if (!matches || header.size > header.capacity || file_size < MappedSchema::file_size(header.capacity))
+            {
+                throw std::runtime_error("Memory mapped SOA vector is corrupt");
+            }
+        }
+    };
+
+    /*!
+     * Throw a 'std::system_error' for the current 'errno'.
+     */
+    [[noreturn]] inline void throw_errno(char const * what)
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+}
+
+/*!
+ * SOA vector whose single memory allocation lives in a memory mapped file,
+ * so the table survives restarts and is available immediately on opening.
+ *
+ * The file starts with a 'detail::MappedHeader' describing the schema, size,
+ * capacity and array offsets, followed by the arrays at the same offsets
+ * 'SOAVector::calculate_array_offsets_and_allocation_size()' gives. The
+ * schema holds the type tag, size and alignment of every column and the
+ * byte order, and a file is only opened with the types it was created
+ * with. Only trivially copyable types are supported, since the bytes are
+ * the objects.
+ *
+ * Changes reach the file through the page cache. Call 'sync()' to make them
+ * durable at a given point.
+ */
+template <typename... Types>
+class MappedSOAVector
+{
+    using Schema = detail::MappedSchema<Types...>;
+public:
+    /*!
+     * The value type of the N'th template argument.
+     */
+    template <std::size_t i>
+    using value_type = decltype(detail::IndexToType<i, Types...>::value);
+
+    using size_type = std::size_t;
+
+    /*!
+     * Open a memory mapped vector, creating an empty one if the file does
+     * not exist or is empty.
+     *
+     * @param path The path of the file.
+     * @throws std::system_error if the file cannot be opened or mapped.
+     * @throws std::runtime_error if the file holds a vector of other types.
+     */
+    explicit MappedSOAVector(std::string const & path)
+    {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+        {
+            detail::throw_errno("open");
+        }
+
+        try
+        {
+            struct stat st;
+            if (::fstat(fd_, &st) != 0)
+            {
+                detail::throw_errno("fstat");
+            }
+
+            if (st.st_size == 0)
+            {
+                this->map(Schema::file_size(0), true);
+                Schema::initialize(*header_, 0);
+            }
+            else
+            {
+                this->map(st.st_size, false);
+                Schema::validate(*header_, mapping_size_);
+            }
+        }
+        catch (...)
+        {
+            this->unmap();
+            ::close(fd_);
+            throw;
+        }
+    }
+
+    MappedSOAVector(MappedSOAVector const &) = delete;
+    MappedSOAVector & operator=(MappedSOAVector const &) = delete;
+
+    /*!
+     * Destructor. Unmaps the file without forcing the data to disk.
+     */
+    ~MappedSOAVector()
+    {
+        this->unmap();
+        ::close(fd_);
+    }
+
+    /*!
+     * Get whether the vector is empty.
+     *
+     * @return True if the vector is empty, otherwise false.
+     */
+    bool empty() const noexcept
+    {
+        return header_->size == 0;
+    }
+
+    /*!
+     * Get the size, i.e. number of elements in the vector.
+     *
+     * @return The number of elements.
+     */
+    size_type size() const noexcept
+    {
+        return header_->size;
+    }
+
+    /*!
+     * Get the capacity, i.e. the number of elements the file can fit.
+     *
+     * @return The capacity.
+     */
+    size_type capacity() const noexcept
+    {
+        return header_->capacity;
+    }
+
+    /*!
+     * Get the pointer to the first element of an array.
+     *
+     * @tparam TypeIndex The index of the array to get the pointer of.
+     * @return The pointer to the first element in the array.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> * data() noexcept
+    {
+        return reinterpret_cast<value_type<TypeIndex> *>(mapping_ + header_->offsets[TypeIndex]);
+    }
+
+    /*!
+     * Get the pointer to the first element of an array.
+     *
+     * @tparam TypeIndex The index of the array to get the pointer of.
+     * @return The pointer to the first element in the array.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> const * data() const noexcept
+    {
+        return reinterpret_cast<value_type<TypeIndex> const *>(mapping_ + header_->offsets[TypeIndex]);
+    }
+
+    /*!
+     * Get a reference to the element of a certain array at a given index.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @param index The index.
+     * @return A reference to the element at the position.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> & get(size_type index) noexcept
+    {
+        assert(index < this->size());
+        return *(this->data<TypeIndex>() + index);
+    }
+
+    /*!
+     * Get a reference to the element of a certain array at a given index.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @param index The index.
+     * @return A reference to the element at the position.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> const & get(size_type index) const noexcept
+    {
+        assert(index < this->size());
+        return *(this->data<TypeIndex>() + index);
+    }
+
+    /*!
+     * Get a span over the elements in a certain array.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @return A span over the elements in the array.
+     */
+    template<size_type TypeIndex>
+    std::span<value_type<TypeIndex>> span() noexcept
+    {
+        return std::span<value_type<TypeIndex>>(this->data<TypeIndex>(), this->size());
+    }
+
+    /*!
+     * Get a span over the elements in a certain array.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @return A span over the elements in the array.
+     */
+    template<size_type TypeIndex>
+    std::span<value_type<TypeIndex> const> span() const noexcept
+    {
+        return std::span<value_type<TypeIndex> const>(this->data<TypeIndex>(), this->size());
+    }
+
+    /*!
+     * Get a view over a range of rows in all arrays.
+     *
+     * @param first The index of the first row in the view.
+     * @param count The number of rows in the view.
+     * @return A span over the rows [first, first + count).
+     */
+    SOASpan<Types...> slice(size_type first, size_type count) noexcept
+    {
+        return [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            return SOASpan<Types...>(this->size(), this->data<TypeIndices>()...).slice(first, count);
+        }(std::index_sequence_for<Types...>{});
+    }
+
+    /*!
+     * Adds a set of elements at the end of each array.
+     *
+     * @param args The elements to add.
+     */
+    void push_back(Types const &... args)
+    {
+        if (this->size() + 1 > this->capacity())
+        {
+            this->reserve(this->size() * growth_factor + 1);
+        }
+
+        size_type const index = this->size();
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            ((this->data<TypeIndices>()[index] = args), ...);
+        }(std::index_sequence_for<Types...>{});
+        header_->size = index + 1;
+    }
+
+    /*!
+     * Remove the last element of each array.
+     */
+    void pop_back() noexcept
+    {
+        assert(this->size() > 0);
+        --header_->size;
+    }
+
+    /*!
+     * Remove all elements, keeping the capacity.
+     */
+    void clear() noexcept
+    {
+        header_->size = 0;
+    }
+
+    /*!
+     * Reserve storage, growing the file.
+     *
+     * The file is extended with 'ftruncate' and remapped, and the arrays are
+     * moved to their offsets for the new capacity. Invalidates all pointers
+     * into the vector.
+     *
+     * @param new_capacity The new capacity of the arrays. Will only grow the
+     *      file if 'new_capacity' is larger than the current capacity.
+     */
+    void reserve(size_type new_capacity)
+    {
+        if (new_capacity <= this->capacity())
+        {
+            return;
+        }
+
+        std::uint64_t const new_file_size = Schema::file_size(new_capacity);
+        if (::ftruncate(fd_, new_file_size) != 0)
+        {
+            detail::throw_errno("ftruncate");
+        }
+        void * const new_mapping = ::mremap(mapping_, mapping_size_, new_file_size, MREMAP_MAYMOVE);
+        if (new_mapping == MAP_FAILED)
+        {
+            detail::throw_errno("mremap");
+        }
+        mapping_ = static_cast<char *>(new_mapping);
+        mapping_size_ = new_file_size;
+        header_ = reinterpret_cast<detail::MappedHeader *>(mapping_);
+
+        // Array offsets only grow with the capacity, so moving the last array
+        // first never overwrites an array that has not been moved yet.
+        detail::MappedHeader old_header = *header_;
+        Schema::set_capacity(*header_, new_capacity);
+        for (size_type i = sizeof...(Types); i-- > 0;)
+        {
+            std::size_t const element_size = header_->element_sizes[i];
+            std::memmove(mapping_ + header_->offsets[i], mapping_ + old_header.offsets[i], header_->size * element_size);
+        }
+    }
+
+    /*!
+     * Flush all changes to the file and wait for them to be written.
+     *
+     * @throws std::system_error if the data could not be written.
+     */
+    void sync()
+    {
+        if (::msync(mapping_, mapping_size_, MS_SYNC) != 0)
+        {
+            detail::throw_errno("msync");
+        }
+    }
+
+private:
+    /*!
+     * Map the file, optionally resizing it first.
+     */
+    void map(std::uint64_t size, bool resize)
+    {
+        if (resize && ::ftruncate(fd_, size) != 0)
+        {
+            detail::throw_errno("ftruncate");
+        }
+        void * const mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapping == MAP_FAILED)
+        {
+            detail::throw_errno("mmap");
+        }
+        mapping_ = static_cast<char *>(mapping);
+        mapping_size_ = size;
+        header_ = reinterpret_cast<detail::MappedHeader *>(mapping_);
+    }
+
+    /*!
+     * Unmap the file, if mapped.
+     */
+    void unmap() noexcept
+    {
+        if (mapping_ != nullptr)
+        {
+            ::munmap(mapping_, mapping_size_);
+            mapping_ = nullptr;
+        }
+    }
+
+    // Member variables:
+    int fd_ = -1;
+    char * mapping_ = nullptr;
+    std::uint64_t mapping_size_ = 0;
+    detail::MappedHeader * header_ = nullptr;
+    static constexpr float growth_factor = 1.5;
+};
+
+namespace detail
+{
+
+    /*!
+     * Calculate a 64 bit checksum of a range of bytes.
+     *
+     * Processes four independent 64 bit lanes to keep up with memory
+     * bandwidth. Not cryptographic; detects corruption, not tampering.
+     */
+    inline std::uint64_t checksum(std::span<std::byte const> bytes) noexcept
+    {
+        constexpr std::uint64_t prime = 0x9E3779B97F4A7C15ull;
+        std::array<std::uint64_t, 4> lanes{prime, prime + 1, prime + 2, prime + 3};
+
+        std::size_t i = 0;
+        for (; i + 32 <= bytes.size(); i += 32)
+        {
+            for (std::size_t lane = 0; lane < lanes.size(); ++lane)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, bytes.data() + i + lane * 8, 8);
+                lanes[lane] = std::rotl((lanes[lane] ^ word) * prime, 31);
+            }
+        }
+        std::uint64_t hash = bytes.size();
+        for (std::uint64_t lane : lanes)
+        {
+            hash = std::rotl((hash ^ lane) * prime, 27);
+        }
+        for (; i < bytes.size(); ++i)
+        {
+            hash = (hash ^ static_cast<std::uint64_t>(bytes[i])) * prime;
+        }
+        return hash ^ (hash >> 29);
+    }
+
+    /*!
+     * Round up to a multiple of an alignment.
+     */
+    constexpr std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment) noexcept
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    /*!
+     * Describes one column of a serialized SOA table.
+     *
+     * Raw columns are stored as 'byte_size' bytes at 'offset'. String
+     * columns are stored as 'size + 1' 64 bit end offsets at 'offset',
+     * followed by the concatenated characters at 'string_bytes_offset'.
+     */
+    struct ColumnDescriptor
+    {
+        /*!
+         * Flag set if 'checksum' holds the checksum of the column.
+         */
+        static constexpr std::uint32_t has_checksum = 1;
+
+        ColumnTypeTag type_tag;
+        std::uint32_t element_size;
+        std::uint32_t element_alignment;
+        std::uint32_t flags;
+        std::uint64_t offset;
+        std::uint64_t byte_size;
+        std::uint64_t string_bytes_offset;
+        std::uint64_t string_bytes_size;
+        std::uint64_t checksum;
+    };
+
+    /*!
+     * Header of a serialized SOA table, followed by one 'ColumnDescriptor'
+     * per column and then the column blocks.
+     */
+    struct ColumnFileHeader
+    {
+        static constexpr std::array<char, 8> expected_magic{'S', 'O', 'A', 'C', 'O', 'L', '\0', '\0'};
+        static constexpr std::uint32_t current_version = 1;
+        static constexpr std::uint32_t native_byte_order = 0x01020304;
+
+        /*!
+         * Alignment of every block in the file, enough for any element type
+         * and for a cache line.
+         */
+        static constexpr std::uint64_t block_alignment = 64;
+
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint32_t column_count;
+        std::uint32_t reserved;
+        std::uint64_t row_count;
+    };
+
+    /*!
+     * Write bytes to a stream at a given offset, padding with zeros from the
+     * current position.
+     */
+    inline void write_block(std::ostream & os, std::uint64_t & position, std::uint64_t offset, void const * data, std::uint64_t size)
+    {
+        static constexpr std::array<char, ColumnFileHeader::block_alignment> padding{};
+        assert(offset >= position && offset - position <= padding.size());
+        os.write(padding.data(), offset - position);
+        os.write(static_cast<char const *>(data), size);
+        position = offset + size;
+    }
+
+    /*!
+     * Describe a column and lay it out in a file starting at a given offset.
+     *
+     * @param column The elements of the column.
+     * @param offset The first free offset, updated to one past the column.
+     * @return The descriptor of the column, except the checksum.
+     */
+    template <typename T>
+    ColumnDescriptor describe_column(std::span<T const> column, std::uint64_t & offset)
+    {
+        ColumnDescriptor descriptor{};
+        descriptor.type_tag = column_type_tag<T>();
+        descriptor.element_size = sizeof(T);
+        descriptor.element_alignment = alignof(T);
+        descriptor.offset = align_up(offset, ColumnFileHeader::block_alignment);
+        if constexpr (is_raw_column<T>)
+        {
+            descriptor.byte_size = column.size_bytes();
+            offset = descriptor.offset + descriptor.byte_size;
+        }
+        else
+        {
+            descriptor.byte_size = (column.size() + 1) * sizeof(std::uint64_t);
+            descriptor.string_bytes_offset = align_up(descriptor.offset + descriptor.byte_size, ColumnFileHeader::block_alignment);
+            for (std::string const & string : column)
+            {
+                descriptor.string_bytes_size += string.size();
+            }
+            offset = descriptor.string_bytes_offset + descriptor.string_bytes_size;
+        }
+        return descriptor;
+    }
+
+    /*!
+     * Write a column at the offsets of its descriptor, and fill in its checksum.
+     */
+    template <typename T>
+    void write_column(std::ostream & os, std::uint64_t & position, std::span<T const> column, ColumnDescriptor & descriptor)
+    {
+        if constexpr (is_raw_column<T>)
+        {
+            auto const bytes = std::as_bytes(column);
+            descriptor.checksum = checksum(bytes);
+            descriptor.flags |= ColumnDescriptor::has_checksum;
+            write_block(os, position, descriptor.offset, bytes.data(), bytes.size());
+        }
+        else
+        {
+            std::vector<std::uint64_t> end_offsets(column.size() + 1);
+            for (std::size_t i = 0; i < column.size(); ++i)
+            {
+                end_offsets[i + 1] = end_offsets[i] + column[i].size();
+            }
+            descriptor.checksum = checksum(std::as_bytes(std::span(end_offsets)));
+            write_block(os, position, descriptor.offset, end_offsets.data(), descriptor.byte_size);
+
+            static constexpr std::array<char, ColumnFileHeader::block_alignment> padding{};
+            os.write(padding.data(), descriptor.string_bytes_offset - position);
+            std::uint64_t bytes_checksum = 0;
+            for (std::string const & string : column)
+            {
+                os.write(string.data(), string.size());
+                bytes_checksum = checksum(std::as_bytes(std::span(string))) ^ std::rotl(bytes_checksum, 1);
+            }
+            descriptor.checksum ^= bytes_checksum;
+            descriptor.flags |= ColumnDescriptor::has_checksum;
+            position = descriptor.string_bytes_offset + descriptor.string_bytes_size;
+        }
+    }
+
+    /*!
+     * Calculate the checksum of a stored column, as 'write_column()' does.
+     */
+    inline std::uint64_t stored_column_checksum(char const * file, ColumnDescriptor const & descriptor)
+    {
+        std::uint64_t sum = checksum(std::as_bytes(std::span(file + descriptor.offset, descriptor.byte_size)));
+        if (descriptor.type_tag == ColumnTypeTag::string)
+        {
+            std::uint64_t const * const end_offsets = reinterpret_cast<std::uint64_t const *>(file + descriptor.offset);
+            std::size_t const count = descriptor.byte_size / sizeof(std::uint64_t) - 1;
+            std::uint64_t bytes_checksum = 0;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                bytes_checksum = checksum(std::as_bytes(std::span(
+                    file + descriptor.string_bytes_offset + end_offsets[i],
+                    end_offsets[i + 1] - end_offsets[i]))) ^ std::rotl(bytes_checksum, 1);
+            }
+            sum ^= bytes_checksum;
+        }
+        return sum;
+    }
+}
+
+namespace detail
+{
+    /*!
+     * Check that the header and column descriptors of a serialized SOA table
+     * describe a table of the given types that fits in the file.
+     *
+     * @param header The header.
+     * @param descriptors The column descriptors, or null if the file is too
+     *      small to hold them.
+     * @param file_size The size of the file.
+     * @throws std::runtime_error if they do not.
+     */
+    template <typename... Types>
+    void validate_column_file(ColumnFileHeader const & header, ColumnDescriptor const * descriptors, std::uint64_t file_size)
+    {
+        if (header.magic != ColumnFileHeader::expected_magic)
+        {
+            throw std::runtime_error("Not a serialized SOA table");
+        }
+        if (header.version != ColumnFileHeader::current_version)
+        {
+            throw std::runtime_error("Unsupported serialized SOA table version");
+        }
+        if (header.byte_order != ColumnFileHeader::native_byte_order)
+        {
+            throw std::runtime_error("Serialized SOA table has a different byte order");
+        }
+        if (header.column_count != sizeof...(Types) || descriptors == nullptr)
+        {
+            throw std::runtime_error("Serialized SOA table has a different schema");
+        }
+
+        std::array<ColumnDescriptor, sizeof...(Types)> const expected{ColumnDescriptor{
+            column_type_tag<Types>(), sizeof(Types), alignof(Types), 0, 0, 0, 0, 0, 0}...};
+        for (std::size_t i = 0; i < sizeof...(Types); ++i)
+        {
+            ColumnDescriptor const & descriptor = descriptors[i];
+            if (descriptor.type_tag != expected[i].type_tag
+                || descriptor.element_size != expected[i].element_size
+                || descriptor.element_alignment != expected[i].element_alignment)
+            {
+                throw std::runtime_error("Serialized SOA table has a different schema");
+            }
+
+            bool const is_string = descriptor.type_tag == ColumnTypeTag::string;
+            std::uint64_t const element_size = is_string ? sizeof(std::uint64_t) : descriptor.element_size;
+            if (descriptor.offset % ColumnFileHeader::block_alignment != 0 || descriptor.offset > file_size)
+            {
+                throw std::runtime_error("Serialized SOA table is corrupt");
+            }
+            // Bound the row count by the bytes left in the file before
+            // multiplying, so the expected size cannot wrap around.
+            std::uint64_t const max_elements = (file_size - descriptor.offset) / element_size;
+            if (max_elements < is_string || header.row_count > max_elements - is_string
+                || descriptor.byte_size != (header.row_count + is_string) * element_size)
+            {
+                throw std::runtime_error("Serialized SOA table is corrupt");
+            }
+        }
+    }
+}
+
+/*!
+ * Read-only, zero-copy view of a SOA table saved with 'save()'.
+ *
+ * Opening memory maps the file and checks the header, without reading or
+ * parsing the column data. Raw columns are accessed in place; string columns
+ * are accessed as 'std::string_view's into the file.
+ */
+template <typename... Types>
+class SOAFile
+{
+    using Header = detail::ColumnFileHeader;
+    using Descriptor = detail::ColumnDescriptor;
+public:
+    /*!
+     * The value type of the N'th template argument.
+     */
+    template <std::size_t i>
+    using value_type = decltype(detail::IndexToType<i, Types...>::value);
+
+    using size_type = std::size_t;
+
+    /*!
+     * Open and map a file.
+     *
+     * @param path The path of the file.
+     * @throws std::system_error if the file cannot be opened or mapped.
+     * @throws std::runtime_error if the file holds a table of other types.
+     */
+    explicit SOAFile(std::string const & path)
+    {
+        int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            detail::throw_errno("open");
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            detail::throw_errno("fstat");
+        }
+        mapping_size_ = st.st_size;
+        void * const mapping = mapping_size_ > 0
+            ? ::mmap(nullptr, mapping_size_, PROT_READ, MAP_PRIVATE, fd, 0)
+            : MAP_FAILED;
+        int const map_errno = errno;
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            if (mapping_size_ == 0)
+            {
+                throw std::runtime_error("Not a serialized SOA table");
+            }
+            errno = map_errno;
+            detail::throw_errno("mmap");
+        }
+        mapping_ = static_cast<char const *>(mapping);
+
+        try
+        {
+            this->validate();
+        }
+        catch (...)
+        {
+            ::munmap(const_cast<char *>(mapping_), mapping_size_);
+            throw;
+        }
+    }
+
+    SOAFile(SOAFile const &) = delete;
+    SOAFile & operator=(SOAFile const &) = delete;
+
+    /*!
+     * Destructor. Unmaps the file.
+     */
+    ~SOAFile()
+    {
+        ::munmap(const_cast<char *>(mapping_), mapping_size_);
+    }
+
+    /*!
+     * Get the number of rows.
+     *
+     * @return The number of rows.
+     */
+    size_type size() const noexcept
+    {
+        return this->header().row_count;
+    }
+
+    /*!
+     * Get a span over the elements of a raw column.
+     *
+     * @tparam TypeIndex The index of the column, which must not be a string column.
+     * @return A span over the elements in the file.
+     */
+    template<size_type TypeIndex>
+    std::span<value_type<TypeIndex> const> span() const noexcept
+    {
+        static_assert(detail::is_raw_column<value_type<TypeIndex>>, "Use 'string()' for string columns");
+        return std::span<value_type<TypeIndex> const>(
+            reinterpret_cast<value_type<TypeIndex> const *>(mapping_ + this->descriptor(TypeIndex).offset),
+            this->size());
+    }
+
+    /*!
+     * Get a string of a string column.
+     *
+     * @tparam TypeIndex The index of the column, which must be a string column.
+     * @param index The index of the row.
+     * @return A view of the string in the file.
+     */
+    template<size_type TypeIndex>
+    std::string_view string(size_type index) const noexcept
+    {
+        static_assert(!detail::is_raw_column<value_type<TypeIndex>>, "Use 'span()' for raw columns");
+        assert(index < this->size());
+        Descriptor const & descriptor = this->descriptor(TypeIndex);
+        std::uint64_t const * const end_offsets = reinterpret_cast<std::uint64_t const *>(mapping_ + descriptor.offset);
+        return std::string_view(
+            mapping_ + descriptor.string_bytes_offset + end_offsets[index],
+            end_offsets[index + 1] - end_offsets[index]);
+    }
+
+    /*!
+     * Get a span over all rows. Only available if there are no string columns.
+     *
+     * @return A span over the rows in the file.
+     */
+    SOASpan<Types const...> rows() const noexcept
+        requires (detail::is_raw_column<Types> && ...)
+    {
+        return [this]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            return SOASpan<Types const...>(this->size(), this->span<TypeIndices>().data()...);
+        }(std::index_sequence_for<Types...>{});
+    }
+
+    /*!
+     * Check the checksums of all columns that have one. Reads the whole file.
+     *
+     * @return True if all checksums match, otherwise false.
+     */
+    bool verify() const
+    {
+        for (size_type i = 0; i < sizeof...(Types); ++i)
+        {
+            Descriptor const & descriptor = this->descriptor(i);
+            if ((descriptor.flags & Descriptor::has_checksum) != 0
+                && detail::stored_column_checksum(mapping_, descriptor) != descriptor.checksum)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    Header const & header() const noexcept
+    {
+        return *reinterpret_cast<Header const *>(mapping_);
+    }
+
+    Descriptor const & descriptor(size_type column) const noexcept
+    {
+        return reinterpret_cast<Descriptor const *>(mapping_ + sizeof(Header))[column];
+    }
+
+    /*!
+     * Check that the header and descriptors describe a table of these types
+     * that fits in the file.
+     */
+    void validate() const
+    {
+        if (mapping_size_ < sizeof(Header))
+        {
+            throw std::runtime_error("Not a serialized SOA table");
+        }
+        detail::validate_column_file<Types...>(
+            this->header(),
+            mapping_size_ >= sizeof(Header) + sizeof...(Types) * sizeof(Descriptor) ? &this->descriptor(0) : nullptr,
+            mapping_size_);
+
+        for (size_type i = 0; i < sizeof...(Types); ++i)
+        {
+            Descriptor const & descriptor = this->descriptor(i);
+            if (descriptor.type_tag == ColumnTypeTag::string)
+            {
+                // 'validate_column_file()' checked that the size() + 1 end
+                // offsets lie within the file.
+                std::uint64_t const * const end_offsets = reinterpret_cast<std::uint64_t const *>(mapping_ + descriptor.offset);
+                if (descriptor.string_bytes_offset > mapping_size_
+                    || descriptor.string_bytes_size > mapping_size_ - descriptor.string_bytes_offset
+                    || end_offsets[0] != 0
+                    || end_offsets[this->size()] != descriptor.string_bytes_size)
+                {
+                    throw std::runtime_error("Serialized SOA table is corrupt");
+                }
+                // 'string()' and the checksum index the characters with these
+                // offsets, so they must not go backwards.
+                for (size_type row = 0; row < this->size(); ++row)
+                {
+                    if (end_offsets[row] > end_offsets[row + 1])
+                    {
+                        throw std::runtime_error("Serialized SOA table is corrupt");
+                    }
+                }
+            }
+        }
+    }
+
+    // Member variables:
+    char const * mapping_ = nullptr;
+    std::uint64_t mapping_size_ = 0;
+};
+
+/*!
+ * Save a SOA vector to a file in a versioned binary columnar format.
+ *
+ * The file has a header with the row count and byte order, a descriptor per
+ * column with its type tag, element size and alignment, location and
+ * checksum, and then one block per column aligned to 64 bytes. Strings are
+ * stored as end offsets plus the concatenated characters.
+ *
+ * @param vec The vector to save.
+ * @param path The path of the file, which is overwritten.
+ * @throws std::runtime_error if the file cannot be written.
+ */
+template <typename... Types>
+void save(SOAVector<Types...> const & vec, std::string const & path)
+{
+    detail::ColumnFileHeader header{};
+    header.magic = detail::ColumnFileHeader::expected_magic;
+    header.version = detail::ColumnFileHeader::current_version;
+    header.byte_order = detail::ColumnFileHeader::native_byte_order;
+    header.column_count = sizeof...(Types);
+    header.row_count = vec.size();
+
+    std::uint64_t offset = sizeof(header) + sizeof...(Types) * sizeof(detail::ColumnDescriptor);
+    std::array<detail::ColumnDescriptor, sizeof...(Types)> descriptors;
+    [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+    {
+        ((descriptors[TypeIndices] = detail::describe_column(vec.template span<TypeIndices>(), offset)), ...);
+    }(std::index_sequence_for<Types...>{});
+
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    if (!os)
+    {
+        throw std::runtime_error("Cannot open '" + path + "' for writing");
+    }
+
+    // Write the columns first, since they fill in the checksums, then go
+    // back and write the header and descriptors.
+    std::uint64_t position = sizeof(header) + sizeof(descriptors);
+    os.seekp(position);
+    [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+    {
+        (detail::write_column(os, position, vec.template span<TypeIndices>(), descriptors[TypeIndices]), ...);
+    }(std::index_sequence_for<Types...>{});
+    os.seekp(0);
+    os.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    os.write(reinterpret_cast<char const *>(descriptors.data()), sizeof(descriptors));
+
+    os.close();
+    if (!os)
+    {
+        throw std::runtime_error("Cannot write '" + path + "'");
+    }
+}
+
+/*!
+ * Load a SOA vector from a file written by 'save()'.
+ *
+ * Verifies the checksums, then copies raw columns with a single 'memcpy'
+ * each into a new allocation. To access the data without copying, use
+ * 'SOAFile' instead.
+ *
+ * @param path The path of the file.
+ * @return The loaded vector.
+ * @throws std::system_error if the file cannot be opened.
+ * @throws std::runtime_error if the file is corrupt or holds other types.
+ */
+template <typename... Types>
+SOAVector<Types...> load(std::string const & path)
+{
+    SOAFile<Types...> const file(path);
+    if (!file.verify())
+    {
+        throw std::runtime_error("Serialized SOA table '" + path + "' has a checksum mismatch");
+    }
+    if (file.size() == 0)
+    {
+        return SOAVector<Types...>();
+    }
+
+    using Storage = typename SOAVector<Types...>::Storage;
+    auto const [offsets, total_num_bytes] = SOAVector<Types...>::calculate_array_offsets_and_allocation_size(file.size());
+    Storage storage;
+    storage.data = static_cast<char *>(
+        ::operator new[](total_num_bytes, std::align_val_t(SOAVector<Types...>::allocation_alignment)));
+    storage.offsets = offsets;
+    storage.size = file.size();
+    storage.capacity = file.size();
+
+    [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+    {
+        (
+            [&]
+            {
+                using T = decltype(detail::IndexToType<TypeIndices, Types...>::value);
+                T * const array = reinterpret_cast<T *>(storage.data + offsets[TypeIndices]);
+                if constexpr (detail::is_raw_column<T>)
+                {
+                    std::memcpy(array, file.template span<TypeIndices>().data(), file.size() * sizeof(T));
+                }
+                else
+                {
+                    for (std::size_t i = 0; i < file.size(); ++i)
+                    {
+                        new(array + i) T(file.template string<TypeIndices>(i));
+                    }
+                }
+            }(),
+            ...
+        );
+    }(std::index_sequence_for<Types...>{});
+
+    return SOAVector<Types...>(std::move(storage));
+}
+
+namespace detail
+{
+    /*!
+     * Header of a streamed SOA table, followed by one 'StreamColumnSchema'
+     * per column and then any number of chunks.
+     */
+    struct StreamFileHeader
+    {
+        static constexpr std::array<char, 8> expected_magic{'S', 'O', 'A', 'S', 'T', 'R', 'M', '\0'};
+        static constexpr std::uint32_t current_version = 1;
+
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint32_t column_count;
+        std::uint32_t reserved;
+        std::uint64_t chunk_rows;
+    };
+
+    /*!
+     * The type of a column in a streamed SOA table.
+     */
+    struct StreamColumnSchema
+    {
+        ColumnTypeTag type_tag;
+        std::uint32_t element_size;
+        std::uint32_t element_alignment;
+        std::uint32_t reserved;
+    };
+
+    /*!
+     * Header of a chunk, followed by one 'StreamChunkColumn' per column and
+     * then the data of each column: the raw bytes, or for strings the
+     * 'row_count + 1' 64 bit end offsets followed by the characters.
+     */
+    struct StreamChunkHeader
+    {
+        static constexpr std::uint32_t expected_magic = 0x4B4E4843; // "CHNK"
+
+        std::uint32_t magic;
+        std::uint32_t reserved;
+        std::uint64_t row_count;
+    };
+
+    /*!
+     * Size, checksum and statistics of a column in a chunk. The minimum and
+     * maximum are stored as the bytes of the element type, for arithmetic
+     * columns only.
+     */
+    struct StreamChunkColumn
+    {
+        std::uint64_t byte_size;
+        std::uint64_t string_bytes_size;
+        std::uint64_t checksum;
+        std::uint64_t min;
+        std::uint64_t max;
+        std::uint32_t has_stats;
+        std::uint32_t reserved;
+    };
+
+    /*!
+     * Whether the chunks of a stream store the minimum and maximum of a column.
+     */
+    template <typename T>
+    inline constexpr bool has_chunk_stats = std::is_arithmetic_v<T> && sizeof(T) <= sizeof(std::uint64_t);
+}
+
+/*!
+ * The minimum and maximum value of a column within a chunk.
+ */
+template <typename T>
+struct ChunkStats
+{
+    T min;
+    T max;
+};
+
+/*!
+ * Writes a SOA table of unbounded size to a file incrementally, in chunks
+ * of a fixed number of rows.
+ *
+ * Rows are buffered until a chunk is full and then written columnar, with a
+ * checksum and, for arithmetic columns, the minimum and maximum value of
+ * each column in the chunk. Read the file back with 'SOAStreamReader'.
+ */
+template <typename... Types>
+class SOAStreamWriter
+{
+public:
+    using size_type = std::size_t;
+
+    /*!
+     * Create a file and write the header.
+     *
+     * @param path The path of the file, which is overwritten.
+     * @param chunk_rows The number of rows per chunk.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    explicit SOAStreamWriter(std::string const & path, size_type chunk_rows = 65536):
+        os_(path, std::ios::binary | std::ios::trunc),
+        chunk_rows_(chunk_rows)
+    {
+        assert(chunk_rows_ > 0);
+        if (!os_)
+        {
+            throw std::runtime_error("Cannot open '" + path + "' for writing");
+        }
+
+        detail::StreamFileHeader header{};
+        header.magic = detail::StreamFileHeader::expected_magic;
+        header.version = detail::StreamFileHeader::current_version;
+        header.byte_order = detail::ColumnFileHeader::native_byte_order;
+        header.column_count = sizeof...(Types);
+        header.chunk_rows = chunk_rows_;
+        std::array<detail::StreamColumnSchema, sizeof...(Types)> const schema{
+            detail::StreamColumnSchema{detail::column_type_tag<Types>(), sizeof(Types), alignof(Types), 0}...};
+        os_.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        os_.write(reinterpret_cast<char const *>(schema.data()), sizeof(schema));
+
+        buffer_.reserve(chunk_rows_);
+    }
+
+    SOAStreamWriter(SOAStreamWriter const &) = delete;
+    SOAStreamWriter & operator=(SOAStreamWriter const &) = delete;
+
+    /*!
+     * Destructor. Writes the remaining rows as a final chunk.
+     *
+     * Errors are ignored; call 'close()' to detect them.
+     */
+    ~SOAStreamWriter()
+    {
+        try
+        {
+            this->close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    /*!
+     * Adds a row, writing a chunk if it becomes full.
+     *
+     * @param args The elements of the row.
+     */
+    void push_back(Types&&... args)
+    {
+        buffer_.push_back(std::forward<Types>(args)...);
+        if (buffer_.size() == chunk_rows_)
+        {
+            this->flush();
+        }
+    }
+
+    /*!
+     * Adds a range of rows, writing chunks as they become full.
+     *
+     * @param rows The rows to add.
+     */
+    void append(SOASpan<Types const...> rows)
+    {
+        while (!rows.empty())
+        {
+            size_type const count = std::min(rows.size(), chunk_rows_ - buffer_.size());
+            buffer_.append(rows.slice(0, count));
+            rows = rows.slice(count, rows.size() - count);
+            if (buffer_.size() == chunk_rows_)
+            {
+                this->flush();
+            }
+        }
+    }
+
+    /*!
+     * Write the buffered rows as a chunk, even if it is not full.
+     *
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void flush()
+    {
+        if (buffer_.empty())
+        {
+            return;
+        }
+
+        detail::StreamChunkHeader const header{detail::StreamChunkHeader::expected_magic, 0, buffer_.size()};
+        std::array<detail::StreamChunkColumn, sizeof...(Types)> columns{};
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            (this->describe(std::as_const(buffer_).template span<TypeIndices>(), columns[TypeIndices]), ...);
+        }(std::index_sequence_for<Types...>{});
+
+        os_.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        os_.write(reinterpret_cast<char const *>(columns.data()), sizeof(columns));
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            (this->write(std::as_const(buffer_).template span<TypeIndices>()), ...);
+        }(std::index_sequence_for<Types...>{});
+        if (!os_)
+        {
+            throw std::runtime_error("Cannot write SOA stream");
+        }
+        buffer_.clear();
+    }
+
+    /*!
+     * Write the remaining rows and close the file.
+     *
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void close()
+    {
+        if (!os_.is_open())
+        {
+            return;
+        }
+        this->flush();
+        os_.close();
+        if (!os_)
+        {
+            throw std::runtime_error("Cannot write SOA stream");
+        }
+    }
+
+private:
+    /*!
+     * Calculate the size, checksum and statistics of a column of the buffer.
+     */
+    template <typename T>
+    void describe(std::span<T const> column, detail::StreamChunkColumn & description)
+    {
+        if constexpr (detail::is_raw_column<T>)
+        {
+            description.byte_size = column.size_bytes();
+            description.checksum = detail::checksum(std::as_bytes(column));
+            if constexpr (detail::has_chunk_stats<T>)
+            {
+                auto const [min, max] = std::minmax_element(column.begin(), column.end());
+                std::memcpy(&description.min, &*min, sizeof(T));
+                std::memcpy(&description.max, &*max, sizeof(T));
+                description.has_stats = 1;
+            }
+        }
+        else
+        {
+            end_offsets_.resize(column.size() + 1);
+            string_bytes_.clear();
+            for (std::size_t i = 0; i < column.size(); ++i)
+            {
+                string_bytes_ += column[i];
+                end_offsets_[i + 1] = string_bytes_.size();
+            }
+            description.byte_size = end_offsets_.size() * sizeof(std::uint64_t);
+            description.string_bytes_size = string_bytes_.size();
+            description.checksum = detail::checksum(std::as_bytes(std::span(end_offsets_)))
+                ^ detail::checksum(std::as_bytes(std::span(string_bytes_)));
+        }
+    }
+
+    /*!
+     * Write the data of a column of the buffer.
+     */
+    template <typename T>
+    void write(std::span<T const> column)
+    {
+        if constexpr (detail::is_raw_column<T>)
+        {
+            os_.write(reinterpret_cast<char const *>(column.data()), column.size_bytes());
+        }
+        else
+        {
+            // Encode again, since the scratch buffers only hold the last string column.
+            std::uint64_t end_offset = 0;
+            end_offsets_.resize(column.size() + 1);
+            for (std::size_t i = 0; i < column.size(); ++i)
+            {
+                end_offset += column[i].size();
+                end_offsets_[i + 1] = end_offset;
+            }
+            os_.write(reinterpret_cast<char const *>(end_offsets_.data()), end_offsets_.size() * sizeof(std::uint64_t));
+            for (std::string const & string : column)
+            {
+                os_.write(string.data(), string.size());
+            }
+        }
+    }
+
+    // Member variables:
+    std::ofstream os_;
+    size_type chunk_rows_;
+    SOAVector<Types...> buffer_;
+    std::vector<std::uint64_t> end_offsets_;
+    std::string string_bytes_;
+};
+
+/*!
+ * Reads a SOA table written by 'SOAStreamWriter' one chunk at a time, for
+ * scanning tables larger than memory.
+ *
+ * 'next()' reads the header of the next chunk, after which its statistics
+ * can be inspected and the chunk either read into a buffer or skipped
+ * without reading its data. Reading into the same buffer for every chunk
+ * reuses its memory allocation, and the memory of its strings as far as
+ * possible, so a scan does not reallocate after the first chunk.
+ */
+template <typename... Types>
+class SOAStreamReader
+{
+public:
+    /*!
+     * The value type of the N'th template argument.
+     */
+    template <std::size_t i>
+    using value_type = decltype(detail::IndexToType<i, Types...>::value);
+
+    using size_type = std::size_t;
+
+    /*!
+     * Open a file and check its header.
+     *
+     * @param path The path of the file.
+     * @throws std::runtime_error if the file cannot be read or holds a table
+     *      of other types.
+     */
+    explicit SOAStreamReader(std::string const & path):
+        is_(path, std::ios::binary)
+    {
+        if (!is_)
+        {
+            throw std::runtime_error("Cannot open '" + path + "' for reading");
+        }
+        is_.seekg(0, std::ios::end);
+        file_size_ = static_cast<std::uint64_t>(is_.tellg());
+        is_.seekg(0);
+
+        detail::StreamFileHeader header{};
+        std::array<detail::StreamColumnSchema, sizeof...(Types)> schema{};
+        is_.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!is_ || header.magic != detail::StreamFileHeader::expected_magic)
+        {
+            throw std::runtime_error("Not a SOA stream");
+        }
+        if (header.version != detail::StreamFileHeader::current_version
+            || header.byte_order != detail::ColumnFileHeader::native_byte_order)
+        {
+            throw std::runtime_error("Unsupported SOA stream version or byte order");
+        }
+        is_.read(reinterpret_cast<char *>(schema.data()), sizeof(schema));
+        std::array<detail::StreamColumnSchema, sizeof...(Types)> const expected{
+            detail::StreamColumnSchema{detail::column_type_tag<Types>(), sizeof(Types), alignof(Types), 0}...};
+        bool matches = is_ && header.column_count == sizeof...(Types);
+        for (size_type i = 0; matches && i < schema.size(); ++i)
+        {
+            matches = schema[i].type_tag == expected[i].type_tag
+                && schema[i].element_size == expected[i].element_size
+                && schema[i].element_alignment == expected[i].element_alignment;
+        }
+        if (!matches)
+        {
+            throw std::runtime_error("SOA stream has a different schema");
+        }
+        chunk_rows_ = header.chunk_rows;
+    }
+
+    /*!
+     * Get the maximum number of rows per chunk, e.g. to reserve a buffer.
+     *
+     * @return The number of rows per chunk.
+     */
+    size_type chunk_rows() const noexcept
+    {
+        return chunk_rows_;
+    }
+
+    /*!
+     * Advance to the next chunk, skipping the current one if it was not read.
+     *
+     * @return True if there is another chunk, false at the end of the file.
+     * @throws std::runtime_error if the chunk header is corrupt.
+     */
+    bool next()
+    {
+        if (has_chunk_)
+        {
+            this->skip();
+        }
+
+        detail::StreamChunkHeader header{};
+        is_.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (is_.gcount() == 0 && is_.eof())
+        {
+            return false;
+        }
+        is_.read(reinterpret_cast<char *>(columns_.data()), sizeof(columns_));
+        if (!is_ || header.magic != detail::StreamChunkHeader::expected_magic || header.row_count > chunk_rows_)
+        {
+            throw std::runtime_error("SOA stream chunk is corrupt");
+        }
+
+        // Check the column sizes against the bytes left in the file, so that
+        // reading the chunk does not allocate more than the file holds.
+        std::uint64_t remaining = file_size_ - static_cast<std::uint64_t>(is_.tellg());
+        bool fits = true;
+        std::size_t type_index = 0;
+        ((fits = fits && column_fits<Types>(columns_[type_index], header.row_count, remaining), ++type_index), ...);
+        if (!fits)
+        {
+            throw std::runtime_error("SOA stream chunk is truncated or corrupt");
+        }
+        chunk_size_ = header.row_count;
+        has_chunk_ = true;
+        return true;
+    }
+
+    /*!
+     * Get the number of rows in the current chunk.
+     *
+     * @return The number of rows.
+     */
+    size_type chunk_size() const noexcept
+    {
+        return chunk_size_;
+    }
+
+    /*!
+     * Get the minimum and maximum of an arithmetic column in the current chunk.
+     *
+     * @tparam TypeIndex The index of the column.
+     * @return The statistics.
+     */
+    template<size_type TypeIndex>
+    ChunkStats<value_type<TypeIndex>> stats() const noexcept
+    {
+        static_assert(detail::has_chunk_stats<value_type<TypeIndex>>, "No statistics for this column type");
+        assert(has_chunk_);
+        ChunkStats<value_type<TypeIndex>> stats;
+        std::memcpy(&stats.min, &columns_[TypeIndex].min, sizeof(value_type<TypeIndex>));
+        std::memcpy(&stats.max, &columns_[TypeIndex].max, sizeof(value_type<TypeIndex>));
+        return stats;
+    }
+
+    /*!
+     * Read the current chunk into a buffer, replacing its contents.
+     *
+     * @param buffer The buffer. Reallocates only if its capacity is less than
+     *      the chunk size.
+     * @throws std::runtime_error if the chunk is truncated or its checksum
+     *      does not match.
+     */
+    void read(SOAVector<Types...> & buffer)
+    {
+        assert(has_chunk_);
+        has_chunk_ = false;
+
+        buffer.resize(chunk_size_);
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            (this->read_column(buffer.template span<TypeIndices>(), columns_[TypeIndices]), ...);
+        }(std::index_sequence_for<Types...>{});
+    }
+
+    /*!
+     * Read the next chunk into a buffer, replacing its contents.
+     *
+     * @param buffer The buffer.
+     * @return True if a chunk was read, false at the end of the file.
+     */
+    bool read_next(SOAVector<Types...> & buffer)
+    {
+        if (!this->next())
+        {
+            return false;
+        }
+        this->read(buffer);
+        return true;
+    }
+
+    /*!
+     * Skip the data of the current chunk without reading it.
+     */
+    void skip()
+    {
+        assert(has_chunk_);
+        has_chunk_ = false;
+
+        std::uint64_t size = 0;
+        for (detail::StreamChunkColumn const & column : columns_)
+        {
+            size += column.byte_size + column.string_bytes_size;
+        }
+        is_.seekg(size, std::ios::cur);
+    }
+
+private:
+    /*!
+     * Check that the data of a column has the size its row count gives and
+     * fits in the rest of the file, and take it from the rest.
+     *
+     * @param column The description of the column.
+     * @param row_count The number of rows of the chunk.
+     * @param remaining The number of bytes left in the file.
+     * @return True if the column fits, otherwise false.
+     */
+    template <typename T>
+    static bool column_fits(detail::StreamChunkColumn const & column, std::uint64_t row_count, std::uint64_t & remaining) noexcept
+    {
+        bool const is_string = !detail::is_raw_column<T>;
+        std::uint64_t const element_size = is_string ? sizeof(std::uint64_t) : sizeof(T);
+        // Bound the row count before multiplying, so the size cannot wrap around.
+        std::uint64_t const max_elements = remaining / element_size;
+        if (max_elements < is_string || row_count > max_elements - is_string
+            || column.byte_size != (row_count + is_string) * element_size)
+        {
+            return false;
+        }
+        remaining -= column.byte_size;
+        if (column.string_bytes_size > remaining)
+        {
+            return false;
+        }
+        remaining -= column.string_bytes_size;
+        return true;
+    }
+
+    /*!
+     * Read the data of a column into the elements of a buffer.
+     */
+    template <typename T>
+    void read_column(std::span<T> column, detail::StreamChunkColumn const & description)
+    {
+        if constexpr (detail::is_raw_column<T>)
+        {
+            if (description.byte_size != column.size_bytes())
+            {
+                throw std::runtime_error("SOA stream chunk is corrupt");
+            }
+            is_.read(reinterpret_cast<char *>(column.data()), column.size_bytes());
+            if (!is_ || detail::checksum(std::as_bytes(column)) != description.checksum)
+            {
+                throw std::runtime_error("SOA stream chunk is truncated or has a checksum mismatch");
+            }
+        }
+        else
+        {
+            if (description.byte_size != (column.size() + 1) * sizeof(std::uint64_t))
+            {
+                throw std::runtime_error("SOA stream chunk is corrupt");
+            }
+            end_offsets_.resize(column.size() + 1);
+            string_bytes_.resize(description.string_bytes_size);
+            is_.read(reinterpret_cast<char *>(end_offsets_.data()), description.byte_size);
+            is_.read(string_bytes_.data(), string_bytes_.size());
+            if (!is_
+                || end_offsets_.back() != string_bytes_.size()
+                || (detail::checksum(std::as_bytes(std::span(end_offsets_)))
+                    ^ detail::checksum(std::as_bytes(std::span(string_bytes_)))) != description.checksum)
+            {
+                throw std::runtime_error("SOA stream chunk is truncated or has a checksum mismatch");
+            }
+            for (std::size_t i = 0; i < column.size(); ++i)
+            {
+                if (end_offsets_[i] > end_offsets_[i + 1])
+                {
+                    throw std::runtime_error("SOA stream chunk is corrupt");
+                }
+                // Assigning reuses the memory of the string from the previous chunk.
+                column[i].assign(string_bytes_, end_offsets_[i], end_offsets_[i + 1] - end_offsets_[i]);
+            }
+        }
+    }
+
+    // Member variables:
+    std::ifstream is_;
+    std::uint64_t file_size_ = 0;
+    size_type chunk_rows_ = 0;
+    size_type chunk_size_ = 0;
+    bool has_chunk_ = false;
+    std::array<detail::StreamChunkColumn, sizeof...(Types)> columns_{};
+    std::vector<std::uint64_t> end_offsets_;
+    std::string string_bytes_;
+};
+
+namespace detail
+{
+    /*!
+     * Minimal io_uring submission and completion ring, set up with the raw
+     * system calls.
+     *
+     * Only the operations the asynchronous SOA file I/O needs are wrapped:
+     * queueing reads and writes, submitting them, and reaping completions.
+     */
+    class IoUring
+    {
+    public:
+        /*!
+         * A completed operation.
+         */
+        struct Completion
+        {
+            std::uint64_t user_data;
+            std::int32_t result;
+        };
+
+        /*!
+         * Set up a ring.
+         *
+         * @param entries The number of submission queue entries.
+         * @throws std::system_error if io_uring is not available.
+         */
+        explicit IoUring(unsigned entries)
+        {
+            io_uring_params params{};
+            fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+            if (fd_ < 0)
+            {
+                throw_errno("io_uring_setup");
+            }
+
+            sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool const single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single_mmap)
+            {
+                sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+            }
+            sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+            sq_ring_ = this->map(sq_ring_size_, IORING_OFF_SQ_RING);
+            cq_ring_ = single_mmap ? sq_ring_ : this->map(cq_ring_size_, IORING_OFF_CQ_RING);
+            sqes_ = static_cast<io_uring_sqe *>(this->map(sqes_size_, IORING_OFF_SQES));
+
+            char * const sq = static_cast<char *>(sq_ring_);
+            sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+            sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+            sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+            sq_entries_ = params.sq_entries;
+
+            char * const cq = static_cast<char *>(cq_ring_);
+            cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+            cq_entries_ = params.cq_entries;
+            cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        }
+
+        IoUring(IoUring const &) = delete;
+        IoUring & operator=(IoUring const &) = delete;
+
+        /*!
+         * Move constructor.
+         */
+        IoUring(IoUring && other) noexcept :
+            fd_(std::exchange(other.fd_, -1)),
+            sq_ring_(std::exchange(other.sq_ring_, nullptr)),
+            cq_ring_(std::exchange(other.cq_ring_, nullptr)),
+            sqes_(std::exchange(other.sqes_, nullptr)),
+            sq_ring_size_(other.sq_ring_size_),
+            cq_ring_size_(other.cq_ring_size_),
+            sqes_size_(other.sqes_size_),
+            sq_head_(other.sq_head_),
+            sq_tail_(other.sq_tail_),
+            sq_array_(other.sq_array_),
+            sq_mask_(other.sq_mask_),
+            sq_entries_(other.sq_entries_),
+            cq_head_(other.cq_head_),
+            cq_tail_(other.cq_tail_),
+            cq_mask_(other.cq_mask_),
+            cqes_(other.cqes_),
+            unsubmitted_(std::exchange(other.unsubmitted_, 0))
+        {
+        }
+
+        IoUring & operator=(IoUring &&) = delete;
+
+        /*!
+         * Destructor. Unmaps the rings and closes the ring file descriptor.
+         */
+        ~IoUring()
+        {
+            if (sqes_ != nullptr)
+            {
+                ::munmap(sqes_, sqes_size_);
+            }
+            if (cq_ring_ != nullptr && cq_ring_ != sq_ring_)
+            {
+                ::munmap(cq_ring_, cq_ring_size_);
+            }
+            if (sq_ring_ != nullptr)
+            {
+                ::munmap(sq_ring_, sq_ring_size_);
+            }
+            if (fd_ >= 0)
+            {
+                ::close(fd_);
+            }
+        }
+
+        /*!
+         * @return The number of submission queue entries.
+         */
+        unsigned entries() const noexcept
+        {
+            return sq_entries_;
+        }
+
+        /*!
+         * @return The number of completion queue entries. At most this many
+         *      operations may be in flight, or completions can be lost.
+         */
+        unsigned completion_entries() const noexcept
+        {
+            return cq_entries_;
+        }
+
+        /*!
+         * Queue a read or write. It is handed to the kernel by the next call
+         * to 'submit()'.
+         *
+         * @param opcode IORING_OP_READ or IORING_OP_WRITE.
+         * @param fd The file descriptor.
+         * @param data The buffer.
+         * @param size The number of bytes.
+         * @param offset The offset in the file.
+         * @param user_data Value returned with the completion.
+         * @return False if the submission queue is full, otherwise true.
+         */
+        bool queue(std::uint8_t opcode, int fd, void * data, std::uint32_t size, std::uint64_t offset,
+                   std::uint64_t user_data) noexcept
+        {
+            unsigned const tail = *sq_tail_;
+            if (tail - std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire) == sq_entries_)
+            {
+                return false;
+            }
+
+            unsigned const index = tail & sq_mask_;
+            io_uring_sqe & sqe = sqes_[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = opcode;
+            sqe.fd = fd;
+            sqe.addr = reinterpret_cast<std::uintptr_t>(data);
+            sqe.len = size;
+            sqe.off = offset;
+            sqe.user_data = user_data;
+            sq_array_[index] = index;
+            std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1, std::memory_order_release);
+            ++unsubmitted_;
+            return true;
+        }
+
+        /*!
+         * Submit the queued operations.
+         *
+         * @param wait If true, block until at least one operation completed.
+         * @throws std::system_error if the kernel rejects the submission.
+         */
+        void submit(bool wait)
+        {
+            while (true)
+            {
+                int const submitted = static_cast<int>(::syscall(__NR_io_uring_enter, fd_, unsubmitted_,
+                    wait ? 1u : 0u, wait ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0));
+                if (submitted >= 0)
+                {
+                    unsubmitted_ -= static_cast<unsigned>(submitted);
+                    return;
+                }
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EBUSY)
+                {
+                    // Out of resources until completions are reaped.
+                    return;
+                }
+                throw_errno("io_uring_enter");
+            }
+        }
+
+        /*!
+         * Call a function for every available completion.
+         *
+         * @param func Function taking a 'Completion'.
+         */
+        template <typename Func>
+        void reap(Func && func)
+        {
+            unsigned head = *cq_head_;
+            unsigned const tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+            while (head != tail)
+            {
+                io_uring_cqe const & cqe = cqes_[head & cq_mask_];
+                Completion const completion{cqe.user_data, cqe.res};
+                ++head;
+                std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+                func(completion);
+            }
+        }
+
+    private:
+        /*!
+         * Map a region of the ring.
+         */
+        void * map(std::size_t size, std::uint64_t offset)
+        {
+            void * const ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                                      static_cast<off_t>(offset));
+            if (ptr == MAP_FAILED)
+            {
+                throw_errno("mmap");
+            }
+            return ptr;
+        }
+
+        // Member variables:
+        int fd_ = -1;
+        void * sq_ring_ = nullptr;
+        void * cq_ring_ = nullptr;
+        io_uring_sqe * sqes_ = nullptr;
+        std::size_t sq_ring_size_ = 0;
+        std::size_t cq_ring_size_ = 0;
+        std::size_t sqes_size_ = 0;
+        unsigned * sq_head_ = nullptr;
+        unsigned * sq_tail_ = nullptr;
+        unsigned * sq_array_ = nullptr;
+        unsigned sq_mask_ = 0;
+        unsigned sq_entries_ = 0;
+        unsigned * cq_head_ = nullptr;
+        unsigned * cq_tail_ = nullptr;
+        unsigned cq_mask_ = 0;
+        unsigned cq_entries_ = 0;
+        io_uring_cqe * cqes_ = nullptr;
+        unsigned unsubmitted_ = 0;
+    };
+
+    /*!
+     * Reads or writes a set of memory regions from or to a file through
+     * io_uring, keeping up to as many requests in flight as the completion
+     * queue holds.
+     *
+     * Regions are split into requests of at most 'max_request_size' bytes.
+     * If direct I/O is enabled and a region's address and file offset agree
+     * modulo 'direct_io_alignment', its page aligned middle goes through an
+     * O_DIRECT descriptor and its unaligned head and tail through the normal
+     * one. Short transfers are resubmitted for the remaining bytes.
+     */
+    class AsyncFileTransfer
+    {
+    public:
+        static constexpr std::uint64_t direct_io_alignment = 4096;
+        static constexpr std::uint64_t max_request_size = std::uint64_t(64) << 20;
+        static constexpr unsigned ring_entries = 64;
+
+        /*!
+         * Constructor. Opens the file.
+         *
+         * @param path The path of the file.
+         * @param opcode IORING_OP_READ or IORING_OP_WRITE.
+         * @param flags The flags for 'open()'.
+         * @param direct Whether to also open the file with O_DIRECT. Ignored if
+         *      the file system does not support it.
+         * @throws std::system_error if the file cannot be opened or io_uring
+         *      is not available.
+         */
+        AsyncFileTransfer(std::string const & path, std::uint8_t opcode, int flags, bool direct) :
+            ring_(ring_entries),
+            opcode_(opcode)
+        {
+            fd_ = ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+            if (fd_ < 0)
+            {
+                throw_errno("open");
+            }
+            if (direct)
+            {
+                direct_fd_ = ::open(path.c_str(), (flags & ~(O_CREAT | O_TRUNC)) | O_CLOEXEC | O_DIRECT);
+            }
+        }
+
+        AsyncFileTransfer(AsyncFileTransfer const &) = delete;
+        AsyncFileTransfer & operator=(AsyncFileTransfer const &) = delete;
+
+        /*!
+         * Move constructor.
+         */
+        AsyncFileTransfer(AsyncFileTransfer && other) noexcept :
+            ring_(std::move(other.ring_)),
+            opcode_(other.opcode_),
+            fd_(std::exchange(other.fd_, -1)),
+            direct_fd_(std::exchange(other.direct_fd_, -1)),
+            requests_(std::move(other.requests_)),
+            pending_(std::move(other.pending_)),
+            in_flight_(std::exchange(other.in_flight_, 0)),
+            error_(other.error_)
+        {
+        }
+
+        AsyncFileTransfer & operator=(AsyncFileTransfer &&) = delete;
+
+        /*!
+         * Destructor. Waits for requests in flight, since the kernel still
+         * accesses their buffers, and closes the file.
+         */
+        ~AsyncFileTransfer()
+        {
+            while (in_flight_ > 0)
+            {
+                try
+                {
+                    ring_.submit(true);
+                }
+                catch (...)
+                {
+                    break;
+                }
+                ring_.reap([this](IoUring::Completion const &) { --in_flight_; });
+            }
+            if (direct_fd_ >= 0)
+            {
+                ::close(direct_fd_);
+            }
+            if (fd_ >= 0)
+            {
+                ::close(fd_);
+            }
+        }
+
+        /*!
+         * Add a region to transfer.
+         *
+         * @param data The start of the region in memory.
+         * @param size The number of bytes.
+         * @param offset The offset of the region in the file.
+         */
+        void add(char * data, std::uint64_t size, std::uint64_t offset)
+        {
+            std::uint64_t const address = reinterpret_cast<std::uintptr_t>(data);
+            if (direct_fd_ >= 0 && address % direct_io_alignment == offset % direct_io_alignment)
+            {
+                std::uint64_t const begin = align_up(offset, direct_io_alignment);
+                std::uint64_t const end = (offset + size) / direct_io_alignment * direct_io_alignment;
+                if (begin < end)
+                {
+                    this->add_requests(fd_, data, begin - offset, offset);
+                    this->add_requests(direct_fd_, data + (begin - offset), end - begin, begin);
+                    this->add_requests(fd_, data + (end - offset), offset + size - end, end);
+                    return;
+                }
+            }
+            this->add_requests(fd_, data, size, offset);
+        }
+
+        /*!
+         * Make progress: reap completions and submit pending requests.
+         *
+         * @param block If true, wait until at least one request completes.
+         * @return True if all requests completed.
+         * @throws std::system_error if a request failed. The other requests
+         *      in flight are completed first.
+         * @throws std::runtime_error if a read hit the end of the file or a
+         *      write made no progress.
+         */
+        bool progress(bool block)
+        {
+            this->reap();
+            if (error_ == 0)
+            {
+                while (!pending_.empty() && in_flight_ < ring_.completion_entries())
+                {
+                    Request const & request = requests_[pending_.back()];
+                    std::uint32_t const size = static_cast<std::uint32_t>(request.size);
+                    if (!ring_.queue(opcode_, request.fd, request.data, size, request.offset, pending_.back()))
+                    {
+                        break;
+                    }
+                    pending_.pop_back();
+                    ++in_flight_;
+                }
+            }
+            if (in_flight_ > 0)
+            {
+                ring_.submit(block);
+                this->reap();
+            }
+
+            if (in_flight_ == 0 && error_ != 0)
+            {
+                int const error = std::exchange(error_, 0);
+                pending_.clear();
+                if (error == -1)
+                {
+                    throw std::runtime_error(opcode_ == IORING_OP_READ
+                        ? "Unexpected end of SOA table file"
+                        : "Write to SOA table file made no progress");
+                }
+                throw std::system_error(error, std::generic_category(), opcode_ == IORING_OP_READ ? "read" : "write");
+            }
+            return pending_.empty() && in_flight_ == 0;
+        }
+
+        /*!
+         * @return The file descriptor for buffered I/O.
+         */
+        int fd() const noexcept
+        {
+            return fd_;
+        }
+
+    private:
+        /*!
+         * A read or write of at most 'max_request_size' bytes.
+         */
+        struct Request
+        {
+            int fd;
+            char * data;
+            std::uint64_t size;
+            std::uint64_t offset;
+        };
+
+        /*!
+         * Split a region into requests.
+         */
+        void add_requests(int fd, char * data, std::uint64_t size, std::uint64_t offset)
+        {
+            for (std::uint64_t done = 0; done < size; done += max_request_size)
+            {
+                pending_.push_back(requests_.size());
+                requests_.push_back({fd, data + done, std::min(max_request_size, size - done), offset + done});
+            }
+        }
+
+        /*!
+         * Handle the available completions.
+         */
+        void reap()
+        {
+            ring_.reap([this](IoUring::Completion const & completion)
+            {
+                --in_flight_;
+                Request & request = requests_[completion.user_data];
+                if (completion.result == -EINTR || completion.result == -EAGAIN)
+                {
+                    pending_.push_back(completion.user_data);
+                }
+                else if (completion.result == -EINVAL && request.fd == direct_fd_)
+                {
+                    // The file system has stricter direct I/O requirements.
+                    request.fd = fd_;
+                    pending_.push_back(completion.user_data);
+                }
+                else if (completion.result < 0)
+                {
+                    error_ = -completion.result;
+                }
+                else if (completion.result == 0)
+                {
+                    // A read past the end of the file, or a write that wrote
+                    // nothing and would be resubmitted forever.
+                    error_ = -1;
+                }
+                else if (static_cast<std::uint64_t>(completion.result) < request.size)
+                {
+                    request.data += completion.result;
+                    request.size -= completion.result;
+                    request.offset += completion.result;
+                    pending_.push_back(completion.user_data);
+                }
+            });
+        }
+
+        // Member variables:
+        IoUring ring_;
+        std::uint8_t opcode_;
+        int fd_ = -1;
+        int direct_fd_ = -1;
+        std::vector<Request> requests_;
+        std::vector<std::size_t> pending_;
+        unsigned in_flight_ = 0;
+        int error_ = 0;
+    };
+}
+
+/*!
+ * Asynchronous save of a SOA vector, started by 'save_async()'.
+ *
+ * Columns are written concurrently through io_uring, in the format of
+ * 'save()' but without checksums. The file offset of each column agrees
+ * with its address modulo the page size, so the bulk of the data is
+ * written with direct I/O where the file system supports it. The header is
+ * written last, so the file is only recognized once it is complete.
+ *
+ * The vector must not be modified or destroyed until the save completes.
+ * Destroying an unfinished save waits for the requests in flight and
+ * leaves an incomplete file.
+ */
+template <typename... Types>
+class AsyncSave
+{
+public:
+    /*!
+     * Constructor. Opens the file and starts writing the columns.
+     *
+     * @param vec The vector to save.
+     * @param path The path of the file, which is overwritten.
+     * @param direct Whether to use direct I/O where possible.
+     * @throws std::system_error if the file cannot be opened or io_uring is
+     *      not available.
+     */
+    AsyncSave(SOAVector<Types...> const & vec, std::string const & path, bool direct) :
+        header_(std::make_unique<Header>()),
+        transfer_(path, IORING_OP_WRITE, O_WRONLY | O_CREAT | O_TRUNC, direct)
+    {
+        Header & header = *header_;
+        header.file_header.magic = detail::ColumnFileHeader::expected_magic;
+        header.file_header.version = detail::ColumnFileHeader::current_version;
+        header.file_header.byte_order = detail::ColumnFileHeader::native_byte_order;
+        header.file_header.column_count = sizeof...(Types);
+        header.file_header.row_count = vec.size();
+
+        std::uint64_t offset = sizeof(Header);
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            (this->add_column(vec.template span<TypeIndices>(), header.descriptors[TypeIndices], offset), ...);
+        }(std::index_sequence_for<Types...>{});
+
+        if (::ftruncate(transfer_.fd(), static_cast<off_t>(offset)) != 0)
+        {
+            detail::throw_errno("ftruncate");
+        }
+        transfer_.progress(false);
+    }
+
+    /*!
+     * Make progress without blocking.
+     *
+     * @return True if the save completed.
+     * @throws std::system_error if a write failed.
+     */
+    bool poll()
+    {
+        return this->progress(false);
+    }
+
+    /*!
+     * Block until the save completes.
+     *
+     * @throws std::system_error if a write failed.
+     */
+    void wait()
+    {
+        while (!this->progress(true))
+        {
+        }
+    }
+
+private:
+    using Descriptor = detail::ColumnDescriptor;
+
+    /*!
+     * The header and descriptors, written as one block at offset 0.
+     */
+    struct Header
+    {
+        detail::ColumnFileHeader file_header;
+        std::array<Descriptor, sizeof...(Types)> descriptors;
+    };
+
+    /*!
+     * Choose the file offset of a block: the first offset from 'offset' that
+     * agrees with the block's address modulo the direct I/O alignment, or
+     * just the next 'block_alignment' boundary if the address is not aligned
+     * to that.
+     */
+    static std::uint64_t place(void const * data, std::uint64_t offset) noexcept
+    {
+        constexpr std::uint64_t page = detail::AsyncFileTransfer::direct_io_alignment;
+        std::uint64_t const address = reinterpret_cast<std::uintptr_t>(data);
+        if (address % detail::ColumnFileHeader::block_alignment != 0)
+        {
+            return detail::align_up(offset, detail::ColumnFileHeader::block_alignment);
+        }
+        std::uint64_t const placed = offset / page * page + address % page;
+        return placed >= offset ? placed : placed + page;
+    }
+
+    /*!
+     * Describe a column and queue its writes. Strings are first encoded into
+     * owned buffers.
+     */
+    template <typename T>
+    void add_column(std::span<T const> column, Descriptor & descriptor, std::uint64_t & offset)
+    {
+        descriptor.type_tag = detail::column_type_tag<T>();
+        descriptor.element_size = sizeof(T);
+        descriptor.element_alignment = alignof(T);
+        if constexpr (detail::is_raw_column<T>)
+        {
+            char * const data = const_cast<char *>(reinterpret_cast<char const *>(column.data()));
+            descriptor.offset = place(data, offset);
+            descriptor.byte_size = column.size_bytes();
+            transfer_.add(data, descriptor.byte_size, descriptor.offset);
+            offset = descriptor.offset + descriptor.byte_size;
+        }
+        else
+        {
+            std::vector<std::uint64_t> & end_offsets = end_offsets_.emplace_back();
+            std::vector<char> & bytes = string_bytes_.emplace_back();
+            end_offsets.reserve(column.size() + 1);
+            end_offsets.push_back(0);
+            for (std::string const & string : column)
+            {
+                bytes.insert(bytes.end(), string.begin(), string.end());
+                end_offsets.push_back(bytes.size());
+            }
+
+            descriptor.offset = place(end_offsets.data(), offset);
+            descriptor.byte_size = end_offsets.size() * sizeof(std::uint64_t);
+            descriptor.string_bytes_offset = place(bytes.data(), descriptor.offset + descriptor.byte_size);
+            descriptor.string_bytes_size = bytes.size();
+            transfer_.add(reinterpret_cast<char *>(end_offsets.data()), descriptor.byte_size, descriptor.offset);
+            transfer_.add(bytes.data(), bytes.size(), descriptor.string_bytes_offset);
+            offset = descriptor.string_bytes_offset + descriptor.string_bytes_size;
+        }
+    }
+
+    /*!
+     * Make progress, and queue the header once all columns are written.
+     */
+    bool progress(bool block)
+    {
+        bool const done = transfer_.progress(block);
+        if (!done || header_written_)
+        {
+            return done && header_written_;
+        }
+        header_written_ = true;
+        transfer_.add(reinterpret_cast<char *>(header_.get()), sizeof(Header), 0);
+        return transfer_.progress(false);
+    }
+
+    // Member variables:
+    // The buffers are declared before 'transfer_', so they are only freed
+    // after the writes in flight are drained.
+    std::unique_ptr<Header> header_;
+    std::vector<std::vector<std::uint64_t>> end_offsets_;
+    std::vector<std::vector<char>> string_bytes_;
+    detail::AsyncFileTransfer transfer_;
+    bool header_written_ = false;
+};
+
+/*!
+ * Asynchronous load of a SOA vector of raw columns, started by
+ * 'load_async()'.
+ *
+ * The header and descriptors are read and validated up front; the columns
+ * are then read concurrently through io_uring directly into the allocation
+ * of the new vector. The allocation is placed so that as many column bytes
+ * as possible agree with their file offset modulo the page size, which
+ * lets them be read with direct I/O. Checksums, if present, are not
+ * verified; use 'SOAFile::verify()' for that.
+ */
+template <typename... Types>
+class AsyncLoad
+{
+    static_assert((detail::is_raw_column<Types> && ...), "Asynchronous load supports raw columns only");
+
+public:
+    /*!
+     * Constructor. Opens the file, validates its header and starts reading
+     * the columns.
+     *
+     * @param path The path of the file.
+     * @param direct Whether to use direct I/O where possible.
+     * @throws std::system_error if the file cannot be opened or io_uring is
+     *      not available.
+     * @throws std::runtime_error if the file is corrupt or holds other types.
+     */
+    AsyncLoad(std::string const & path, bool direct) :
+        transfer_(path, IORING_OP_READ, O_RDONLY, direct)
+    {
+        struct stat status;
+        if (::fstat(transfer_.fd(), &status) != 0)
+        {
+            detail::throw_errno("fstat");
+        }
+        std::uint64_t const file_size = static_cast<std::uint64_t>(status.st_size);
+
+        detail::ColumnFileHeader header{};
+        std::array<Descriptor, sizeof...(Types)> descriptors{};
+        if (::pread(transfer_.fd(), &header, sizeof(header), 0) != sizeof(header))
+        {
+            throw std::runtime_error("Not a serialized SOA table");
+        }
+        bool const has_descriptors =
+            ::pread(transfer_.fd(), descriptors.data(), sizeof(descriptors), sizeof(header)) == sizeof(descriptors);
+        detail::validate_column_file<Types...>(header, has_descriptors ? descriptors.data() : nullptr, file_size);
+
+        size_type const size = header.row_count;
+        if (size == 0)
+        {
+            return;
+        }
+
+        // Place the allocation so that the largest number of column bytes
+        // agree with their file offsets modulo the page size.
+        constexpr std::uint64_t page = detail::AsyncFileTransfer::direct_io_alignment;
+        auto const [offsets, total_num_bytes] = SOAVector<Types...>::calculate_array_offsets_and_allocation_size(size);
+        std::uint64_t shift = 0;
+        std::uint64_t best_num_bytes = 0;
+        for (std::size_t i = 0; i < sizeof...(Types); ++i)
+        {
+            std::uint64_t const candidate = (descriptors[i].offset + page - static_cast<std::uint64_t>(offsets[i]) % page) % page;
+            std::uint64_t num_bytes = 0;
+            for (std::size_t j = 0; j < sizeof...(Types); ++j)
+            {
+                if ((candidate + offsets[j]) % page == descriptors[j].offset % page)
+                {
+                    num_bytes += descriptors[j].byte_size;
+                }
+            }
+            if (num_bytes > best_num_bytes)
+            {
+                shift = candidate;
+                best_num_bytes = num_bytes;
+            }
+        }
+
+        allocation_.reset(static_cast<char *>(::operator new[](total_num_bytes + shift, std::align_val_t(page))));
+        storage_.data = allocation_.get() + shift;
+        storage_.offsets = offsets;
+        storage_.size = size;
+        storage_.capacity = size;
+
+        for (std::size_t i = 0; i < sizeof...(Types); ++i)
+        {
+            transfer_.add(storage_.data + offsets[i], descriptors[i].byte_size, descriptors[i].offset);
+        }
+        transfer_.progress(false);
+    }
+
+    /*!
+     * Make progress without blocking.
+     *
+     * @return True if the load completed.
+     * @throws std::system_error if a read failed.
+     * @throws std::runtime_error if the file is truncated.
+     */
+    bool poll()
+    {
+        return transfer_.progress(false);
+    }
+
+    /*!
+     * Block until the load completes and take the loaded vector. Call at
+     * most once.
+     *
+     * @return The loaded vector.
+     * @throws std::system_error if a read failed.
+     * @throws std::runtime_error if the file is truncated.
+     */
+    SOAVector<Types...> wait()
+    {
+        while (!transfer_.progress(true))
+        {
+        }
+        if (!allocation_)
+        {
+            return SOAVector<Types...>();
+        }
+        storage_.deleter = [allocation = allocation_.release()](char *)
+        {
+            AllocationDeleter()(allocation);
+        };
+        return SOAVector<Types...>(std::move(storage_));
+    }
+
+private:
+    using Descriptor = detail::ColumnDescriptor;
+    using size_type = typename SOAVector<Types...>::size_type;
+
+    /*!
+     * Frees the page aligned allocation.
+     */
+    struct AllocationDeleter
+    {
+        void operator()(char * const ptr) const noexcept
+        {
+            ::operator delete[](ptr, std::align_val_t(detail::AsyncFileTransfer::direct_io_alignment));
+        }
+    };
+
+    // Member variables:
+    // The allocation is declared before 'transfer_', so it is only freed
+    // after the reads in flight are drained.
+    std::unique_ptr<char[], AllocationDeleter> allocation_;
+    typename SOAVector<Types...>::Storage storage_;
+    detail::AsyncFileTransfer transfer_;
+};
+
+/*!
+ * Start saving a SOA vector to a file asynchronously through io_uring.
+ *
+ * @param vec The vector to save, which must stay unmodified until the save
+ *      completes.
+ * @param path The path of the file, which is overwritten.
+ * @param direct Whether to use direct I/O where possible.
+ * @return The save in progress; poll or wait on it.
+ * @throws std::system_error if the file cannot be opened or io_uring is not
+ *      available.
+ */
+template <typename... Types>
+AsyncSave<Types...> save_async(SOAVector<Types...> const & vec, std::string const & path, bool direct = true)
+{
+    return AsyncSave<Types...>(vec, path, direct);
+}
+
+/*!
+ * Start loading a SOA vector of raw columns from a file asynchronously
+ * through io_uring.
+ *
+ * @param path The path of the file, written by 'save()' or 'save_async()'.
+ * @param direct Whether to use direct I/O where possible.
+ * @return The load in progress; poll it, or wait on it for the vector.
+ * @throws std::system_error if the file cannot be opened or io_uring is not
+ *      available.
+ * @throws std::runtime_error if the file is corrupt or holds other types.
+ */
+template <typename... Types>
+AsyncLoad<Types...> load_async(std::string const & path, bool direct = true)
+{
+    return AsyncLoad<Types...>(path, direct);
+}
+
+/*!
+ * Options for 'parse_csv()' and 'load_csv()'.
+ */
+struct CsvOptions
+{
+    /*!
+     * The field delimiter.
+     */
+    char delimiter = ',';
+
+    /*!
+     * Whether the first record is a header to skip.
+     */
+    bool has_header = true;
+
+    /*!
+     * The maximum number of threads, or 0 for the hardware concurrency.
+     */
+    std::size_t threads = 0;
+
+    /*!
+     * The minimum number of bytes per chunk parsed by one thread.
+     */
+    std::size_t min_chunk_size = std::size_t(1) << 20;
+};
+
+namespace detail
+{
+    /*!
+     * Find the first occurrence of any of three characters.
+     *
+     * Compares 16 bytes at a time with SSE2 where available.
+     *
+     * @return Pointer to the first occurrence, or 'last' if there is none.
+     */
+    inline char const * find_any_of(char const * first, char const * last, char a, char b, char c) noexcept
+    {
+#if defined(__SSE2__)
+        __m128i const va = _mm_set1_epi8(a);
+        __m128i const vb = _mm_set1_epi8(b);
+        __m128i const vc = _mm_set1_epi8(c);
+        for (; last - first >= 16; first += 16)
+        {
+            __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(first));
+            __m128i const matches = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(block, va), _mm_cmpeq_epi8(block, vb)), _mm_cmpeq_epi8(block, vc));
+            unsigned const mask = static_cast<unsigned>(_mm_movemask_epi8(matches));
+            if (mask != 0)
+            {
+                return first + std::countr_zero(mask);
+            }
+        }
+#endif
+        for (; first != last; ++first)
+        {
+            if (*first == a || *first == b || *first == c)
+            {
+                return first;
+            }
+        }
+        return last;
+    }
+
+    /*!
+     * Count the occurrences of a character.
+     *
+     * Compares 16 bytes at a time with SSE2 where available.
+     */
+    inline std::size_t count_char(char const * first, char const * last, char c) noexcept
+    {
+        std::size_t count = 0;
+#if defined(__SSE2__)
+        __m128i const vc = _mm_set1_epi8(c);
+        for (; last - first >= 16; first += 16)
+        {
+            __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(first));
+            count += std::popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, vc))));
+        }
+#endif
+        return count + static_cast<std::size_t>(std::count(first, last, c));
+    }
+
+    /*!
+     * Find the end of the record containing a position, given whether the
+     * position is inside a quoted field.
+     *
+     * @return Pointer past the terminating newline, or 'last'.
+     */
+    inline char const * find_csv_record_end(char const * first, char const * last, bool in_quotes) noexcept
+    {
+        while (true)
+        {
+            first = find_any_of(first, last, '"', '\n', '\n');
+            if (first == last)
+            {
+                return last;
+            }
+            if (*first == '\n' && !in_quotes)
+            {
+                return first + 1;
+            }
+            in_quotes ^= *first == '"';
+            ++first;
+        }
+    }
+
+    /*!
+     * Throw a CSV parse error.
+     *
+     * @param text The start of the text.
+     * @param position The position of the error.
+     * @param column The index of the column.
+     */
+    [[noreturn]] inline void throw_csv_error(char const * text, char const * position, std::size_t column)
+    {
+        throw std::runtime_error("CSV parse error at byte " + std::to_string(position - text)
+                                 + " in column " + std::to_string(column));
+    }
+
+    /*!
+     * Parse a field into a value.
+     *
+     * Numbers are parsed with 'std::from_chars' straight from the text.
+     * Booleans are 0, 1, false or true. Strings may be quoted, with "" for a
+     * quote inside the field. A quote inside an unquoted field is an error,
+     * so every quote in valid text opens or closes a quoted field, which is
+     * what 'parse_csv()' relies on to split the text.
+     *
+     * @param first The start of the field.
+     * @param last The end of the text.
+     * @param delimiter The field delimiter.
+     * @param value The value to assign.
+     * @return Pointer past the field, or null if it cannot be parsed.
+     */
+    template <typename T>
+    char const * parse_csv_field(char const * first, char const * last, char delimiter, T & value)
+    {
+        if constexpr (std::is_same_v<T, std::string>)
+        {
+            if (first == last || *first != '"')
+            {
+                char const * const end = find_any_of(first, last, delimiter, '\n', '\r');
+                if (std::memchr(first, '"', end - first) != nullptr)
+                {
+                    return nullptr;
+                }
+                value.assign(first, end);
+                return end;
+            }
+            value.clear();
+            for (++first; ; first += 2)
+            {
+                char const * const quote = static_cast<char const *>(std::memchr(first, '"', last - first));
+                if (quote == nullptr)
+                {
+                    return nullptr;
+                }
+                value.append(first, quote);
+                if (quote + 1 == last || quote[1] != '"')
+                {
+                    return quote + 1;
+                }
+                value += '"';
+                first = quote;
+            }
+        }
+        else
+        {
+            bool const quoted = first != last && *first == '"';
+            char const * const begin = first + quoted;
+            char const * end = begin;
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                end = find_any_of(begin, last, quoted ? '"' : delimiter, '\n', '\r');
+                std::string_view const field(begin, end - begin);
+                if (field == "1" || field == "true")
+                {
+                    value = true;
+                }
+                else if (field == "0" || field == "false")
+                {
+                    value = false;
+                }
+                else
+                {
+                    return nullptr;
+                }
+            }
+            else
+            {
+                auto const [ptr, ec] = std::from_chars(begin, last, value);
+                if (ec != std::errc())
+                {
+                    return nullptr;
+                }
+                end = ptr;
+            }
+            if (quoted)
+            {
+                if (end == last || *end != '"')
+                {
+                    return nullptr;
+                }
+                ++end;
+            }
+            return end;
+        }
+    }
+
+    /*!
+     * Parse the records of a chunk into a vector.
+     *
+     * The vector is sized for the upper bound of one record per newline and
+     * the fields are parsed straight into its arrays. Empty lines are
+     * skipped.
+     *
+     * @param text The start of the whole text, for error messages.
+     * @param first The start of the chunk, at the start of a record.
+     * @param last The end of the chunk, at the end of a record.
+     * @param delimiter The field delimiter.
+     * @return The parsed records.
+     * @throws std::runtime_error if a record cannot be parsed.
+     */
+    template <typename... Types>
+    SOAVector<Types...> parse_csv_chunk(char const * text, char const * first, char const * last, char delimiter)
+    {
+        SOAVector<Types...> vec;
+        vec.resize(count_char(first, last, '\n') + 1);
+
+        std::size_t row = 0;
+        while (first != last)
+        {
+            if (*first == '\n' || (*first == '\r' && last - first > 1 && first[1] == '\n'))
+            {
+                first += *first == '\r' ? 2 : 1;
+                continue;
+            }
+
+            [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+            {
+                (
+                    [&]
+                    {
+                        if constexpr (TypeIndices > 0)
+                        {
+                            if (first == last || *first != delimiter)
+                            {
+                                throw_csv_error(text, first, TypeIndices);
+                            }
+                            ++first;
+                        }
+                        char const * const end = parse_csv_field(first, last, delimiter, vec.template get<TypeIndices>(row));
+                        if (end == nullptr)
+                        {
+                            throw_csv_error(text, first, TypeIndices);
+                        }
+                        first = end;
+                    }(),
+                    ...
+                );
+            }(std::index_sequence_for<Types...>{});
+
+            if (first != last && *first == '\r')
+            {
+                ++first;
+            }
+            if (first != last)
+            {
+                if (*first != '\n')
+                {
+                    throw_csv_error(text, first, sizeof...(Types));
+                }
+                ++first;
+            }
+            ++row;
+        }
+        vec.resize(row);
+        return vec;
+    }
+}
+
+/*!
+ * Parse CSV text into a SOA vector.
+ *
+ * The text is split into chunks of whole records, which are parsed in
+ * parallel and then concatenated. To split correctly at newlines inside
+ * quoted fields, the quotes of each chunk are counted first, which gives
+ * whether each chunk starts inside quotes. Delimiters, quotes and newlines
+ * are found with SIMD compares.
+ *
+ * Each record must have one field per type. Supported types are
+ * arithmetic types and 'std::string'. Fields may be quoted, with "" for a
+ * quote; a quote inside an unquoted field is a parse error, so the result
+ * does not depend on where the text is split. Records end with LF or CRLF;
+ * empty lines are skipped.
+ *
+ * @param text The CSV text.
+ * @param options The delimiter, header and threading options.
+ * @return The parsed vector.
+ * @throws std::runtime_error if a record cannot be parsed.
+ */
+template <typename... Types>
+SOAVector<Types...> parse_csv(std::string_view text, CsvOptions const & options = {})
+{
+    static_assert(((std::is_arithmetic_v<Types> || std::is_same_v<Types, std::string>) && ...),
+                  "CSV columns must be arithmetic types or std::string");
+
+    char const * const begin = text.data();
+    char const * const end = text.data() + text.size();
+    char const * const first = options.has_header ? detail::find_csv_record_end(begin, end, false) : begin;
+
+    std::size_t const thread_count = options.threads != 0 ? options.threads
+        : std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    std::size_t const chunk_count = std::clamp<std::size_t>(
+        static_cast<std::size_t>(end - first) / std::max<std::size_t>(options.min_chunk_size, 1), 1, thread_count);
+
+    // Run a function for each chunk, on its own thread except the first.
+    auto const for_each_chunk = [chunk_count](auto const & func)
+    {
+        std::mutex mutex;
+        std::exception_ptr exception;
+        auto const worker = [&](std::size_t chunk)
+        {
+            try
+            {
+                func(chunk);
+            }
+            catch (...)
+            {
+                std::lock_guard lock(mutex);
+                if (!exception)
+                {
+                    exception = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(chunk_count - 1);
+        for (std::size_t chunk = 1; chunk < chunk_count; ++chunk)
+        {
+            threads.emplace_back(worker, chunk);
+        }
+        worker(0);
+        for (std::thread & thread : threads)
+        {
+            thread.join();
+        }
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    };
+
+    // Split at even offsets, count the quotes before each split, and move
+    // each split to the end of the record it falls in.
+    std::vector<char const *> splits(chunk_count + 1, end);
+    std::vector<std::size_t> quote_counts(chunk_count, 0);
+    for (std::size_t chunk = 0; chunk < chunk_count; ++chunk)
+    {
+        splits[chunk] = first + (end - first) * chunk / chunk_count;
+    }
+    for_each_chunk([&](std::size_t chunk)
+    {
+        quote_counts[chunk] = detail::count_char(splits[chunk], splits[chunk + 1], '"');
+    });
+    bool in_quotes = false;
+    for (std::size_t chunk = 1; chunk < chunk_count; ++chunk)
+    {
+        in_quotes ^= quote_counts[chunk - 1] % 2 != 0;
+        splits[chunk] = detail::find_csv_record_end(splits[chunk], end, in_quotes);
+    }
+
+    std::vector<SOAVector<Types...>> parts(chunk_count);
+    for_each_chunk([&](std::size_t chunk)
+    {
+        parts[chunk] = detail::parse_csv_chunk<Types...>(begin, splits[chunk], splits[chunk + 1], options.delimiter);
+    });
+
+    std::size_t total_size = 0;
+    for (SOAVector<Types...> const & part : parts)
+    {
+        total_size += part.size();
+    }
+    SOAVector<Types...> vec = std::move(parts[0]);
+    vec.reserve(total_size);
+    for (std::size_t chunk = 1; chunk < chunk_count; ++chunk)
+    {
+        vec.append(std::move(parts[chunk]));
+    }
+    return vec;
+}
+
+/*!
+ * Load a CSV file into a SOA vector. The file is memory mapped and parsed
+ * with 'parse_csv()'.
+ *
+ * @param path The path of the file.
+ * @param options The delimiter, header and threading options.
+ * @return The parsed vector.
+ * @throws std::system_error if the file cannot be read.
+ * @throws std::runtime_error if a record cannot be parsed.
+ */
+template <typename... Types>
+SOAVector<Types...> load_csv(std::string const & path, CsvOptions const & options = {})
+{
+    int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        detail::throw_errno("open");
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0)
+    {
+        int const error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "fstat");
+    }
+    std::size_t const size = static_cast<std::size_t>(status.st_size);
+    if (size == 0)
+    {
+        ::close(fd);
+        return SOAVector<Types...>();
+    }
+
+    void * const mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        detail::throw_errno("mmap");
+    }
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+
+    try
+    {
+        SOAVector<Types...> vec = parse_csv<Types...>(std::string_view(static_cast<char const *>(mapping), size), options);
+        ::munmap(mapping, size);
+        return vec;
+    }
+    catch (...)
+    {
+        ::munmap(mapping, size);
+        throw;
+    }
+}
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+/*!
+ * Schema of an array, as defined by the Apache Arrow C data interface.
+ */
+struct ArrowSchema
+{
+    const char * format;
+    const char * name;
+    const char * metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema ** children;
+    struct ArrowSchema * dictionary;
+    void (*release)(struct ArrowSchema *);
+    void * private_data;
+};
+
+/*!
+ * Array data, as defined by the Apache Arrow C data interface.
+ */
+struct ArrowArray
+{
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void ** buffers;
+    struct ArrowArray ** children;
+    struct ArrowArray * dictionary;
+    void (*release)(struct ArrowArray *);
+    void * private_data;
+};
+
+#endif
+
+namespace detail
+{
+    /*!
+     * @return The Arrow format string of a column type.
+     */
+    template <typename T>
+    constexpr char const * arrow_format() noexcept
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            return "b";
+        }
+        else if constexpr (std::is_same_v<T, std::string>)
+        {
+            return "U";
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            static_assert(sizeof(T) == 4 || sizeof(T) == 8, "Unsupported Arrow floating point type");
+            return sizeof(T) == 4 ? "f" : "g";
+        }
+        else
+        {
+            static_assert(std::is_integral_v<T> && sizeof(T) <= 8, "Unsupported Arrow column type");
+            constexpr std::array<char const *, 4> signed_formats{"c", "s", "i", "l"};
+            constexpr std::array<char const *, 4> unsigned_formats{"C", "S", "I", "L"};
+            constexpr std::size_t index = std::countr_zero(sizeof(T));
+            return std::is_signed_v<T> ? signed_formats[index] : unsigned_formats[index];
+        }
+    }
+
+    /*!
+     * Check that no value in the range of an Arrow array is null.
+     *
+     * @param array The array.
+     * @param offset The offset of the range, including that of the parent.
+     * @param length The length of the range.
+     * @return True if the array has no validity buffer or no null in the range.
+     */
+    inline bool arrow_all_valid(ArrowArray const & array, std::int64_t offset, std::int64_t length) noexcept
+    {
+        if (array.null_count == 0 || array.n_buffers == 0 || array.buffers[0] == nullptr)
+        {
+            return true;
+        }
+        std::uint8_t const * const validity = static_cast<std::uint8_t const *>(array.buffers[0]);
+        for (std::int64_t i = offset; i < offset + length; ++i)
+        {
+            if ((validity[i / 8] & (1u << (i % 8))) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+/*!
+ * Export a SOA vector through the Apache Arrow C data interface.
+ *
+ * The table becomes a struct array ("+s") with one child array per column.
+ * Arithmetic columns are exported without copying: the vector is moved
+ * into the export and its arrays become the Arrow data buffers, which stay
+ * valid until every exported array is released. 'bool' columns are packed
+ * into bitmaps and 'std::string' columns converted to large UTF-8 arrays,
+ * which copies them. Columns have no nulls, so no validity buffers are
+ * exported.
+ *
+ * @param vec The vector to export; move it in to avoid copying it.
+ * @param out_array Set to the exported array.
+ * @param out_schema Set to the schema of the exported array.
+ * @param names The column names. Empty names default to the column index.
+ */
+template <typename... Types>
+void export_arrow(SOAVector<Types...> vec, ArrowArray * out_array, ArrowSchema * out_schema,
+                  std::array<std::string, sizeof...(Types)> names = {})
+{
+    constexpr std::size_t column_count = sizeof...(Types);
+
+    // The vector and the converted columns, shared by all exported arrays.
+    struct Table
+    {
+        SOAVector<Types...> vec;
+        std::array<std::array<void const *, 3>, column_count> buffers{};
+        std::array<std::vector<std::uint8_t>, column_count> bitmaps;
+        std::array<std::vector<std::int64_t>, column_count> string_offsets;
+        std::array<std::string, column_count> string_bytes;
+    };
+
+    // Private data of the exported struct array. The children are owned by
+    // it, but may be moved out and released on their own, so each holds its
+    // own reference to the table.
+    struct ArrayData
+    {
+        std::array<void const *, 1> buffers{};
+        std::array<ArrowArray, column_count> children{};
+        std::array<ArrowArray *, column_count> child_pointers{};
+    };
+
+    // Private data of the exported struct schema. Each child owns its name.
+    struct SchemaData
+    {
+        std::array<ArrowSchema, column_count> children{};
+        std::array<ArrowSchema *, column_count> child_pointers{};
+    };
+
+    auto const table = std::make_shared<Table>();
+    table->vec = std::move(vec);
+    std::int64_t const length = static_cast<std::int64_t>(table->vec.size());
+    [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+    {
+        (
+            [&]
+            {
+                using T = decltype(detail::IndexToType<TypeIndices, Types...>::value);
+                auto const column = table->vec.template span<TypeIndices>();
+                std::array<void const *, 3> & buffers = table->buffers[TypeIndices];
+                if constexpr (std::is_same_v<T, bool>)
+                {
+                    std::vector<std::uint8_t> & bitmap = table->bitmaps[TypeIndices];
+                    bitmap.resize((column.size() + 7) / 8);
+                    for (std::size_t i = 0; i < column.size(); ++i)
+                    {
+                        bitmap[i / 8] |= static_cast<std::uint8_t>(column[i] << (i % 8));
+                    }
+                    buffers[1] = bitmap.data();
+                }
+                else if constexpr (std::is_same_v<T, std::string>)
+                {
+                    std::vector<std::int64_t> & offsets = table->string_offsets[TypeIndices];
+                    std::string & bytes = table->string_bytes[TypeIndices];
+                    offsets.reserve(column.size() + 1);
+                    offsets.push_back(0);
+                    for (std::string const & string : column)
+                    {
+                        bytes += string;
+                        offsets.push_back(static_cast<std::int64_t>(bytes.size()));
+                    }
+                    buffers[1] = offsets.data();
+                    buffers[2] = bytes.data();
+                }
+                else
+                {
+                    buffers[1] = column.data();
+                }
+            }(),
+            ...
+        );
+    }(std::index_sequence_for<Types...>{});
+
+    constexpr std::array<bool, column_count> is_string{std::is_same_v<Types, std::string>...};
+    auto * const array_data = new ArrayData{};
+    for (std::size_t i = 0; i < column_count; ++i)
+    {
+        array_data->children[i] = ArrowArray{
+            length, 0, 0, is_string[i] ? 3 : 2, 0, table->buffers[i].data(), nullptr, nullptr,
+            [](ArrowArray * array)
+            {
+                delete static_cast<std::shared_ptr<Table> *>(array->private_data);
+                array->release = nullptr;
+            },
+            new std::shared_ptr<Table>(table)};
+        array_data->child_pointers[i] = &array_data->children[i];
+    }
+    *out_array = ArrowArray{
+        length, 0, 0, 1, column_count, array_data->buffers.data(), array_data->child_pointers.data(), nullptr,
+        [](ArrowArray * array)
+        {
+            auto * const data = static_cast<ArrayData *>(array->private_data);
+            for (ArrowArray & child : data->children)
+            {
+                if (child.release != nullptr)
+                {
+                    child.release(&child);
+                }
+            }
+            delete data;
+            array->release = nullptr;
+        },
+        array_data};
+
+    static constexpr std::array<char const *, column_count> formats{detail::arrow_format<Types>()...};
+    auto * const schema_data = new SchemaData{};
+    for (std::size_t i = 0; i < column_count; ++i)
+    {
+        auto * const name = new std::string(names[i].empty() ? std::to_string(i) : std::move(names[i]));
+        schema_data->children[i] = ArrowSchema{
+            formats[i], name->c_str(), nullptr, 0, 0, nullptr, nullptr,
+            [](ArrowSchema * schema)
+            {
+                delete static_cast<std::string *>(schema->private_data);
+                schema->release = nullptr;
+            },
+            name};
+        schema_data->child_pointers[i] = &schema_data->children[i];
+    }
+    *out_schema = ArrowSchema{
+        "+s", "", nullptr, 0, column_count, schema_data->child_pointers.data(), nullptr,
+        [](ArrowSchema * schema)
+        {
+            auto * const data = static_cast<SchemaData *>(schema->private_data);
+            for (ArrowSchema & child : data->children)
+            {
+                if (child.release != nullptr)
+                {
+                    child.release(&child);
+                }
+            }
+            delete data;
+            schema->release = nullptr;
+        },
+        schema_data};
+}
+
+/*!
+ * Zero-copy SOA view of a table imported through the Apache Arrow C data
+ * interface.
+ *
+ * The table must be a struct array with one child array per type, of the
+ * matching Arrow format and without nulls. The view takes ownership of the
+ * array and releases it when destroyed. Its spans point straight into the
+ * Arrow data buffers. Only fixed-width columns can be viewed without
+ * copying, so 'bool' and 'std::string' columns are not supported.
+ */
+template <typename... Types>
+class ArrowTableView
+{
+    static_assert(((std::is_arithmetic_v<Types> && !std::is_same_v<Types, bool>) && ...),
+                  "Arrow views support fixed-width arithmetic columns only");
+
+public:
+    using size_type = std::size_t;
+
+    /*!
+     * Import a table. Takes ownership of the array and marks it released.
+     * The schema is only checked, and then released.
+     *
+     * @param array The array to import.
+     * @param schema The schema of the array.
+     * @throws std::runtime_error if the schema does not match the types, or
+     *      the array has nulls or misaligned buffers. The array and schema
+     *      are released either way.
+     */
+    ArrowTableView(ArrowArray * array, ArrowSchema * schema) :
+        array_(*array)
+    {
+        array->release = nullptr;
+        bool const schema_matches = matches(*schema);
+        if (schema->release != nullptr)
+        {
+            schema->release(schema);
+        }
+        if (!schema_matches)
+        {
+            this->release();
+            throw std::runtime_error("Arrow schema does not match the SOA types");
+        }
+
+        bool valid = array_.n_children == sizeof...(Types)
+            && array_.length >= 0
+            && detail::arrow_all_valid(array_, array_.offset, array_.length);
+        std::tuple<Types const *...> ptrs{};
+        if (valid)
+        {
+            [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+            {
+                (
+                    [&]
+                    {
+                        using T = decltype(detail::IndexToType<TypeIndices, Types...>::value);
+                        ArrowArray const & child = *array_.children[TypeIndices];
+                        std::int64_t const offset = array_.offset + child.offset;
+                        T const * const data = child.n_buffers == 2 && child.buffers[1] != nullptr
+                            ? static_cast<T const *>(child.buffers[1]) + offset : nullptr;
+                        valid = valid
+                            && child.length >= array_.offset + array_.length
+                            && (data != nullptr || array_.length == 0)
+                            && reinterpret_cast<std::uintptr_t>(data) % alignof(T) == 0
+                            && detail::arrow_all_valid(child, offset, array_.length);
+                        std::get<TypeIndices>(ptrs) = data;
+                    }(),
+                    ...
+                );
+            }(std::index_sequence_for<Types...>{});
+        }
+        if (!valid)
+        {
+            this->release();
+            throw std::runtime_error("Arrow array does not match the SOA types or has nulls");
+        }
+
+        view_ = std::apply([this](auto... data) { return SOASpan<Types const...>(array_.length, data...); }, ptrs);
+    }
+
+    ArrowTableView(ArrowTableView const &) = delete;
+    ArrowTableView & operator=(ArrowTableView const &) = delete;
+
+    /*!
+     * Move constructor. The other view is left empty.
+     */
+    ArrowTableView(ArrowTableView && other) noexcept :
+        array_(other.array_),
+        view_(std::exchange(other.view_, {}))
+    {
+        other.array_.release = nullptr;
+    }
+
+    /*!
+     * Move assignment operator. The other view is left empty.
+     */
+    ArrowTableView & operator=(ArrowTableView && other) noexcept
+    {
+        if (this != &other)
+        {
+            this->release();
+            array_ = other.array_;
+            view_ = std::exchange(other.view_, {});
+            other.array_.release = nullptr;
+        }
+        return *this;
+    }
+
+    /*!
+     * Destructor. Releases the array.
+     */
+    ~ArrowTableView()
+    {
+        this->release();
+    }
+
+    /*!
+     * @return The number of rows.
+     */
+    size_type size() const noexcept
+    {
+        return view_.size();
+    }
+
+    /*!
+     * @return A view of all rows.
+     */
+    SOASpan<Types const...> view() const noexcept
+    {
+        return view_;
+    }
+
+    /*!
+     * @tparam TypeIndex The index of the column.
+     * @return A span of the elements of a column.
+     */
+    template <std::size_t TypeIndex>
+    auto span() const noexcept
+    {
+        return view_.template span<TypeIndex>();
+    }
+
+private:
+    /*!
+     * @return True if the schema is a struct with a child of the matching
+     *      format per type.
+     */
+    static bool matches(ArrowSchema const & schema) noexcept
+    {
+        static constexpr std::array<std::string_view, sizeof...(Types)> formats{detail::arrow_format<Types>()...};
+        if (schema.format == nullptr || std::string_view(schema.format) != "+s" || schema.n_children != sizeof...(Types))
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < sizeof...(Types); ++i)
+        {
+            if (schema.children[i]->format == nullptr || schema.children[i]->format != formats[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*!
+     * Release the array if it is not released yet.
+     */
+    void release() noexcept
+    {
+        if (array_.release != nullptr)
+        {
+            array_.release(&array_);
+        }
+    }
+
+    // Member variables:
+    ArrowArray array_;
+    SOASpan<Types const...> view_;
+};
+
+/*!
+ * SOA vector in a POSIX shared memory segment, so several processes can use
+ * one copy of a table without copying it.
+ *
+ * The segment has the layout of a 'MappedSOAVector' file: a
+ * 'detail::MappedHeader' describing the schema, size, capacity and array
+ * offsets, followed by the arrays. One process creates the segment with a
+ * fixed capacity and appends rows. Any number of processes attach to it
+ * read-only, which only maps the segment, and see the rows the writer has
+ * published. Rows are published by storing the size with release
+ * semantics, so readers can run while the writer appends.
+ *
+ * The capacity cannot grow, since that would move the arrays under the
+ * readers. Only trivially copyable types are supported. The segment lives
+ * until 'remove()' is called and all processes have detached.
+ */
+template <typename... Types>
+class SharedSOAVector
+{
+    using Schema = detail::MappedSchema<Types...>;
+public:
+    /*!
+     * The value type of the N'th template argument.
+     */
+    template <std::size_t i>
+    using value_type = decltype(detail::IndexToType<i, Types...>::value);
+
+    using size_type = std::size_t;
+
+    /*!
+     * Create a shared memory segment and open it for writing.
+     *
+     * @param name The name of the segment, e.g. "/prices".
+     * @param capacity The number of rows the segment can hold.
+     * @throws std::system_error if the segment exists or cannot be created.
+     */
+    SharedSOAVector(std::string const & name, size_type capacity) :
+        writable_(true)
+    {
+        int const fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            detail::throw_errno("shm_open");
+        }
+        std::uint64_t const size = Schema::file_size(capacity);
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+        {
+            int const error = errno;
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw std::system_error(error, std::generic_category(), "ftruncate");
+        }
+        this->map(fd, size, PROT_READ | PROT_WRITE);
+        if (mapping_ == nullptr)
+        {
+            int const error = errno;
+            ::shm_unlink(name.c_str());
+            throw std::system_error(error, std::generic_category(), "mmap");
+        }
+        Schema::initialize(*header_, capacity);
+    }
+
+    /*!
+     * Attach to an existing shared memory segment read-only. The segment
+     * must have been created completely.
+     *
+     * @param name The name of the segment.
+     * @throws std::system_error if the segment cannot be opened or mapped.
+     * @throws std::runtime_error if the segment holds a vector of other
+     *      types.
+     */
+    explicit SharedSOAVector(std::string const & name) :
+        writable_(false)
+    {
+        int const fd = ::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            detail::throw_errno("shm_open");
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            int const error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "fstat");
+        }
+        if (static_cast<std::uint64_t>(st.st_size) < sizeof(detail::MappedHeader))
+        {
+            ::close(fd);
+            throw std::runtime_error("Not a memory mapped SOA vector");
+        }
+        this->map(fd, static_cast<std::uint64_t>(st.st_size), PROT_READ);
+        if (mapping_ == nullptr)
+        {
+            detail::throw_errno("mmap");
+        }
+        try
+        {
+            Schema::validate(*header_, mapping_size_);
+        }
+        catch (...)
+        {
+            this->unmap();
+            throw;
+        }
+    }
+
+    SharedSOAVector(SharedSOAVector const &) = delete;
+    SharedSOAVector & operator=(SharedSOAVector const &) = delete;
+
+    /*!
+     * Move constructor. The other vector is left detached.
+     */
+    SharedSOAVector(SharedSOAVector && other) noexcept :
+        mapping_(std::exchange(other.mapping_, nullptr)),
+        mapping_size_(std::exchange(other.mapping_size_, 0)),
+        header_(std::exchange(other.header_, nullptr)),
+        writable_(other.writable_)
+    {
+    }
+
+    SharedSOAVector & operator=(SharedSOAVector &&) = delete;
+
+    /*!
+     * Destructor. Detaches from the segment without removing it.
+     */
+    ~SharedSOAVector()
+    {
+        this->unmap();
+    }
+
+    /*!
+     * Remove a shared memory segment. Processes attached to it keep their
+     * mappings.
+     *
+     * @param name The name of the segment.
+     * @return True if the segment existed, otherwise false.
+     */
+    static bool remove(std::string const & name) noexcept
+    {
+        return ::shm_unlink(name.c_str()) == 0;
+    }
+
+    /*!
+     * @return True if this process created the segment and may append to it.
+     */
+    bool writable() const noexcept
+    {
+        return writable_;
+    }
+
+    /*!
+     * Get whether the vector is empty.
+     *
+     * @return True if the vector is empty, otherwise false.
+     */
+    bool empty() const noexcept
+    {
+        return this->size() == 0;
+    }
+
+    /*!
+     * Get the number of published rows.
+     *
+     * @return The number of elements.
+     */
+    size_type size() const noexcept
+    {
+        return std::atomic_ref<std::uint64_t>(header_->size).load(std::memory_order_acquire);
+    }
+
+    /*!
+     * Get the capacity, i.e. the number of elements the segment can fit.
+     *
+     * @return The capacity.
+     */
+    size_type capacity() const noexcept
+    {
+        return header_->capacity;
+    }
+
+    /*!
+     * Get the pointer to the first element of an array.
+     *
+     * @tparam TypeIndex The index of the array to get the pointer of.
+     * @return The pointer to the first element in the array.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> const * data() const noexcept
+    {
+        return reinterpret_cast<value_type<TypeIndex> const *>(mapping_ + header_->offsets[TypeIndex]);
+    }
+
+    /*!
+     * Get a reference to the element of a certain array at a given index.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @param index The index.
+     * @return A reference to the element at the position.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> const & get(size_type index) const noexcept
+    {
+        assert(index < this->size());
+        return *(this->data<TypeIndex>() + index);
+    }
+
+    /*!
+     * Get a span over the elements in a certain array.
+     *
+     * @tparam TypeIndex The index of the array.
+     * @return A span over the published elements in the array.
+     */
+    template<size_type TypeIndex>
+    std::span<value_type<TypeIndex> const> span() const noexcept
+    {
+        return std::span<value_type<TypeIndex> const>(this->data<TypeIndex>(), this->size());
+    }
+
+    /*!
+     * Get a view over all published rows.
+     *
+     * @return A span over the rows.
+     */
+    SOASpan<Types const...> view() const noexcept
+    {
+        return [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            return SOASpan<Types const...>(this->size(), this->data<TypeIndices>()...);
+        }(std::index_sequence_for<Types...>{});
+    }
+
+    /*!
+     * Adds a set of elements at the end of each array and publishes them.
+     * Only for the writer.
+     *
+     * @param args The elements to add.
+     * @throws std::length_error if the segment is full.
+     */
+    void push_back(Types const &... args)
+    {
+        assert(writable_);
+        size_type const index = header_->size;
+        if (index == this->capacity())
+        {
+            throw std::length_error("Shared SOA vector is full");
+        }
+
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            ((this->mutable_data<TypeIndices>()[index] = args), ...);
+        }(std::index_sequence_for<Types...>{});
+        std::atomic_ref<std::uint64_t>(header_->size).store(index + 1, std::memory_order_release);
+    }
+
+    /*!
+     * Adds rows at the end of each array and publishes them at once. Only
+     * for the writer.
+     *
+     * @param rows The rows to add.
+     * @throws std::length_error if they do not fit in the segment.
+     */
+    void append(SOASpan<Types const...> rows)
+    {
+        assert(writable_);
+        size_type const old_size = header_->size;
+        if (rows.size() > this->capacity() - old_size)
+        {
+            throw std::length_error("Shared SOA vector is full");
+        }
+
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            (std::copy_n(rows.template data<TypeIndices>(), rows.size(), this->mutable_data<TypeIndices>() + old_size), ...);
+        }(std::index_sequence_for<Types...>{});
+        std::atomic_ref<std::uint64_t>(header_->size).store(old_size + rows.size(), std::memory_order_release);
+    }
+
+private:
+    /*!
+     * Get the pointer to the first element of an array, for the writer.
+     */
+    template<size_type TypeIndex>
+    value_type<TypeIndex> * mutable_data() noexcept
+    {
+        return reinterpret_cast<value_type<TypeIndex> *>(mapping_ + header_->offsets[TypeIndex]);
+    }
+
+    /*!
+     * Map the segment and close its file descriptor, which the mapping does
+     * not need. Leaves 'mapping_' null if mapping fails.
+     */
+    void map(int fd, std::uint64_t size, int protection) noexcept
+    {
+        void * const mapping = ::mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+        int const error = errno;
+        ::close(fd);
+        errno = error;
+        if (mapping != MAP_FAILED)
+        {
+            mapping_ = static_cast<char *>(mapping);
+            mapping_size_ = size;
+            header_ = reinterpret_cast<detail::MappedHeader *>(mapping_);
+        }
+    }
+
+    /*!
+     * Unmap the segment, if mapped.
+     */
+    void unmap() noexcept
+    {
+        if (mapping_ != nullptr)
+        {
+            ::munmap(mapping_, mapping_size_);
+            mapping_ = nullptr;
+        }
+    }
+
+    // Member variables:
+    char * mapping_ = nullptr;
+    std::uint64_t mapping_size_ = 0;
+    detail::MappedHeader * header_ = nullptr;
+    bool writable_;
+};
+
+namespace detail
+{
+    /*!
+     * Header of a SOA checkpoint file. It is followed by one
+     * 'CheckpointEntry' per vector, one 'CheckpointColumn' per column of all
+     * vectors, the concatenated names, and then one block per vector,
+     * aligned to 'block_alignment'. That is the largest page size of common
+     * Linux platforms (64 KiB on some arm64 and ppc64 kernels), so the blocks
+     * can be memory mapped wherever the file is read.
+     */
+    struct CheckpointHeader
+    {
+        static constexpr std::array<char, 8> expected_magic{'S', 'O', 'A', 'C', 'K', 'P', 'T', '\0'};
+        static constexpr std::uint32_t current_version = 2;
+        static constexpr std::uint64_t block_alignment = 65536;
+
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint64_t entry_count;
+        std::uint64_t column_count;
+        std::uint64_t names_size;
+        std::uint64_t file_size;
+    };
+
+    /*!
+     * A vector in a checkpoint. Its block holds the single allocation of a
+     * 'SOAVector' with a capacity of 'row_count'.
+     */
+    struct CheckpointEntry
+    {
+        std::uint64_t name_offset;
+        std::uint64_t name_size;
+        std::uint64_t first_column;
+        std::uint64_t column_count;
+        std::uint64_t row_count;
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    /*!
+     * A column of a vector in a checkpoint, at 'offset' from the start of the
+     * vector's block.
+     */
+    struct CheckpointColumn
+    {
+        ColumnTypeTag type_tag;
+        std::uint32_t element_size;
+        std::uint32_t element_alignment;
+        std::uint32_t reserved;
+        std::uint64_t offset;
+    };
+}
+
+/*!
+ * Writes many SOA vectors into a single checkpoint file, to be restored
+ * with 'SOACheckpointReader'.
+ *
+ * The file starts with a manifest listing the name, schema, size and
+ * location of each vector, followed by one page aligned block per vector
+ * that holds its arrays exactly as laid out in a 'SOAVector' allocation.
+ * Restoring therefore needs no parsing or pointer fix-up: each vector
+ * adopts its block as is. Only trivially copyable types are supported.
+ */
+class SOACheckpointWriter
+{
+public:
+    /*!
+     * Add a vector to the checkpoint. The vector is not copied, so it must
+     * stay alive and unmodified until 'write()' returns.
+     *
+     * @param name The name to restore the vector by.
+     * @param vec The vector.
+     */
+    template <typename... Types>
+    void add(std::string name, SOAVector<Types...> const & vec)
+    {
+        static_assert((detail::is_raw_column<Types> && ...), "Checkpoints support trivially copyable types only");
+        assert(std::none_of(vectors_.begin(), vectors_.end(), [&](Vector const & other) { return other.name == name; }));
+
+        auto const [offsets, total_num_bytes] = SOAVector<Types...>::calculate_array_offsets_and_allocation_size(vec.size());
+        Vector & vector = vectors_.emplace_back();
+        vector.name = std::move(name);
+        vector.row_count = vec.size();
+        vector.size = vec.empty() ? 0 : total_num_bytes;
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            (
+                vector.columns.push_back({
+                    detail::CheckpointColumn{
+                        detail::column_type_tag<Types>(), sizeof(Types), alignof(Types), 0,
+                        static_cast<std::uint64_t>(offsets[TypeIndices])},
+                    std::as_bytes(vec.template span<TypeIndices>())}),
+                ...
+            );
+        }(std::index_sequence_for<Types...>{});
+    }
+
+    /*!
+     * Write all added vectors to a file. The file is written under a unique
+     * temporary name, flushed to disk and then renamed, so an existing
+     * checkpoint is only replaced by a complete one, even after a crash, and
+     * concurrent writers to the same path do not interfere.
+     *
+     * @param path The path of the file.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void write(std::string const & path) const
+    {
+        using Header = detail::CheckpointHeader;
+
+        Header header{};
+        header.magic = Header::expected_magic;
+        header.version = Header::current_version;
+        header.byte_order = detail::ColumnFileHeader::native_byte_order;
+        header.entry_count = vectors_.size();
+
+        std::vector<detail::CheckpointEntry> entries;
+        std::vector<detail::CheckpointColumn> columns;
+        std::string names;
+        for (Vector const & vector : vectors_)
+        {
+            entries.push_back({names.size(), vector.name.size(), columns.size(), vector.columns.size(),
+                               vector.row_count, 0, vector.size});
+            names += vector.name;
+            for (Column const & column : vector.columns)
+            {
+                columns.push_back(column.descriptor);
+            }
+        }
+        header.column_count = columns.size();
+        header.names_size = names.size();
+
+        std::uint64_t offset = sizeof(Header) + entries.size() * sizeof(detail::CheckpointEntry)
+            + columns.size() * sizeof(detail::CheckpointColumn) + names.size();
+        for (detail::CheckpointEntry & entry : entries)
+        {
+            entry.offset = detail::align_up(offset, Header::block_alignment);
+            offset = entry.offset + entry.size;
+        }
+        header.file_size = offset;
+
+        std::string temporary_path = path + ".XXXXXX";
+        int const fd = ::mkstemp(temporary_path.data());
+        if (fd < 0)
+        {
+            throw std::runtime_error("Cannot create a temporary file for '" + path + "'");
+        }
+        try
+        {
+            // mkstemp() makes the file private to the owner; a checkpoint gets
+            // the permissions of any other output file.
+            if (::fchmod(fd, 0644) != 0)
+            {
+                detail::throw_errno("fchmod");
+            }
+            std::uint64_t position = 0;
+            auto const write_at = [fd](void const * data, std::uint64_t size, std::uint64_t offset)
+            {
+                char const * bytes = static_cast<char const *>(data);
+                while (size > 0)
+                {
+                    ssize_t const count = ::pwrite(fd, bytes, size, static_cast<off_t>(offset));
+                    if (count < 0 && errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (count < 0)
+                    {
+                        detail::throw_errno("write");
+                    }
+                    bytes += count;
+                    size -= static_cast<std::uint64_t>(count);
+                    offset += static_cast<std::uint64_t>(count);
+                }
+            };
+            write_at(&header, sizeof(header), position);
+            position += sizeof(header);
+            write_at(entries.data(), entries.size() * sizeof(detail::CheckpointEntry), position);
+            position += entries.size() * sizeof(detail::CheckpointEntry);
+            write_at(columns.data(), columns.size() * sizeof(detail::CheckpointColumn), position);
+            position += columns.size() * sizeof(detail::CheckpointColumn);
+            write_at(names.data(), names.size(), position);
+            for (std::size_t i = 0; i < vectors_.size(); ++i)
+            {
+                // Padding between arrays and blocks is left as holes.
+                for (Column const & column : vectors_[i].columns)
+                {
+                    write_at(column.bytes.data(), column.bytes.size(), entries[i].offset + column.descriptor.offset);
+                }
+            }
+            // Extend the file to the end of the last block.
+            if (::ftruncate(fd, static_cast<off_t>(header.file_size)) != 0)
+            {
+                detail::throw_errno("ftruncate");
+            }
+            if (::fsync(fd) != 0)
+            {
+                detail::throw_errno("fsync");
+            }
+        }
+        catch (...)
+        {
+            ::close(fd);
+            ::unlink(temporary_path.c_str());
+            throw;
+        }
+        if (::close(fd) != 0 || std::rename(temporary_path.c_str(), path.c_str()) != 0)
+        {
+            ::unlink(temporary_path.c_str());
+            throw std::runtime_error("Cannot write '" + path + "'");
+        }
+
+        // Make the rename itself durable.
+        std::string::size_type const slash = path.rfind('/');
+        std::string const directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        int const directory_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (directory_fd < 0)
+        {
+            detail::throw_errno("open");
+        }
+        int const result = ::fsync(directory_fd);
+        ::close(directory_fd);
+        if (result != 0)
+        {
+            detail::throw_errno("fsync");
+        }
+    }
+
+private:
+    /*!
+     * A column to write, and its descriptor.
+     */
+    struct Column
+    {
+        detail::CheckpointColumn descriptor;
+        std::span<std::byte const> bytes;
+    };
+
+    /*!
+     * A vector to write.
+     */
+    struct Vector
+    {
+        std::string name;
+        std::uint64_t row_count = 0;
+        std::uint64_t size = 0;
+        std::vector<Column> columns;
+    };
+
+    // Member variables:
+    std::vector<Vector> vectors_;
+};
+
+/*!
+ * Restores SOA vectors from a checkpoint written by 'SOACheckpointWriter'.
+ *
+ * The file is either memory mapped copy-on-write, so restoring is
+ * immediate and pages are read on first access, or read into memory with
+ * a single large read at disk bandwidth. Either way, each restored vector
+ * adopts its block of the mapping or buffer as its allocation, which is
+ * freed once the reader and all vectors restored from it are gone or have
+ * reallocated.
+ */
+class SOACheckpointReader
+{
+public:
+    /*!
+     * How to bring the file into memory.
+     */
+    enum class Mode
+    {
+        map,
+        read,
+    };
+
+    /*!
+     * Open a checkpoint and read its manifest.
+     *
+     * @param path The path of the file.
+     * @param mode Whether to map the file or read it into memory. The file
+     *      is read if the page size is too large to map its blocks.
+     * @throws std::system_error if the file cannot be opened, mapped or read.
+     * @throws std::runtime_error if the file is not a valid checkpoint.
+     */
+    explicit SOACheckpointReader(std::string const & path, Mode mode = Mode::map)
+    {
+        int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            detail::throw_errno("open");
+        }
+        try
+        {
+            this->load(fd, mode);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+    }
+
+    /*!
+     * @return The names of the vectors in the checkpoint.
+     */
+    std::vector<std::string_view> names() const
+    {
+        std::vector<std::string_view> names;
+        for (detail::CheckpointEntry const & entry : entries_)
+        {
+            names.push_back(this->name(entry));
+        }
+        return names;
+    }
+
+    /*!
+     * Restore a vector. Each vector can only be restored once, since it
+     * takes over its block of the file.
+     *
+     * @param name The name of the vector.
+     * @return The vector.
+     * @throws std::runtime_error if there is no vector with that name, it
+     *      has other types, or it was restored already.
+     */
+    template <typename... Types>
+    SOAVector<Types...> restore(std::string_view name)
+    {
+        static_assert((detail::is_raw_column<Types> && ...), "Checkpoints support trivially copyable types only");
+
+        auto const it = std::find_if(entries_.begin(), entries_.end(),
+                                     [&](detail::CheckpointEntry const & entry) { return this->name(entry) == name; });
+        if (it == entries_.end())
+        {
+            throw std::runtime_error("Checkpoint has no vector '" + std::string(name) + "'");
+        }
+        std::size_t const index = static_cast<std::size_t>(it - entries_.begin());
+        detail::CheckpointEntry const & entry = *it;
+        if (restored_[index])
+        {
+            throw std::runtime_error("Vector '" + std::string(name) + "' was restored already");
+        }
+
+        using Storage = typename SOAVector<Types...>::Storage;
+        std::size_t const size = entry.row_count;
+        auto const [offsets, total_num_bytes] = SOAVector<Types...>::calculate_array_offsets_and_allocation_size(size);
+        bool matches = entry.column_count == sizeof...(Types) && (size == 0 ? entry.size == 0 : entry.size == total_num_bytes);
+        if (matches)
+        {
+            std::size_t type_index = 0;
+            ((matches = matches
+                && columns_[entry.first_column + type_index].type_tag == detail::column_type_tag<Types>()
+                && columns_[entry.first_column + type_index].element_size == sizeof(Types)
+                && columns_[entry.first_column + type_index].element_alignment == alignof(Types)
+                && columns_[entry.first_column + type_index].offset == static_cast<std::uint64_t>(offsets[type_index]),
+              ++type_index), ...);
+        }
+        if (!matches)
+        {
+            throw std::runtime_error("Vector '" + std::string(name) + "' has a different schema");
+        }
+
+        restored_[index] = true;
+        if (size == 0)
+        {
+            return SOAVector<Types...>();
+        }
+
+        Storage storage;
+        storage.data = data_.get() + (entry.offset - data_offset_);
+        storage.offsets = offsets;
+        storage.size = size;
+        storage.capacity = size;
+        storage.deleter = [data = data_](char *) {};
+        return SOAVector<Types...>(std::move(storage));
+    }
+
+private:
+    /*!
+     * Read and check the manifest, then map or read the blocks.
+     */
+    void load(int fd, Mode mode)
+    {
+        using Header = detail::CheckpointHeader;
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            detail::throw_errno("fstat");
+        }
+        std::uint64_t const file_size = static_cast<std::uint64_t>(st.st_size);
+
+        Header header{};
+        if (::pread(fd, &header, sizeof(header), 0) != sizeof(header) || header.magic != Header::expected_magic)
+        {
+            throw std::runtime_error("Not a SOA checkpoint");
+        }
+        if (header.version != Header::current_version)
+        {
+            throw std::runtime_error("Unsupported SOA checkpoint version");
+        }
+        if (header.byte_order != detail::ColumnFileHeader::native_byte_order)
+        {
+            throw std::runtime_error("SOA checkpoint has a different byte order");
+        }
+        // Bound each count by the bytes left before multiplying, so the
+        // manifest size cannot wrap around.
+        std::uint64_t remaining = file_size - sizeof(header);
+        if (header.file_size != file_size || header.entry_count > remaining / sizeof(detail::CheckpointEntry))
+        {
+            throw std::runtime_error("SOA checkpoint is corrupt");
+        }
+        remaining -= header.entry_count * sizeof(detail::CheckpointEntry);
+        if (header.column_count > remaining / sizeof(detail::CheckpointColumn))
+        {
+            throw std::runtime_error("SOA checkpoint is corrupt");
+        }
+        remaining -= header.column_count * sizeof(detail::CheckpointColumn);
+        if (header.names_size > remaining)
+        {
+            throw std::runtime_error("SOA checkpoint is corrupt");
+        }
+
+        entries_.resize(header.entry_count);
+        columns_.resize(header.column_count);
+        names_.resize(header.names_size);
+        std::uint64_t position = sizeof(header);
+        auto const read = [&](void * data, std::uint64_t size)
+        {
+            if (::pread(fd, data, size, static_cast<off_t>(position)) != static_cast<ssize_t>(size))
+            {
+                throw std::runtime_error("SOA checkpoint is corrupt");
+            }
+            position += size;
+        };
+        read(entries_.data(), entries_.size() * sizeof(detail::CheckpointEntry));
+        read(columns_.data(), columns_.size() * sizeof(detail::CheckpointColumn));
+        read(names_.data(), names_.size());
+        restored_.assign(entries_.size(), false);
+
+        // The blocks must follow each other in the order of the entries, so
+        // no two restored vectors share memory.
+        data_offset_ = detail::align_up(position, Header::block_alignment);
+        std::uint64_t block_end = data_offset_;
+        for (detail::CheckpointEntry const & entry : entries_)
+        {
+            if (entry.offset % Header::block_alignment != 0 || entry.offset < block_end
+                || entry.size > file_size || entry.offset > file_size - entry.size
+                || entry.name_offset > names_.size() || entry.name_size > names_.size() - entry.name_offset
+                || entry.first_column > columns_.size() || entry.column_count > columns_.size() - entry.first_column)
+            {
+                throw std::runtime_error("SOA checkpoint is corrupt");
+            }
+            block_end = entry.offset + entry.size;
+        }
+        if (file_size <= data_offset_)
+        {
+            return;
+        }
+
+        std::uint64_t const data_size = file_size - data_offset_;
+        // The blocks can only be mapped if they are page aligned, which holds
+        // unless the page size exceeds 'block_alignment'.
+        long const page_size = ::sysconf(_SC_PAGESIZE);
+        if (mode == Mode::map && page_size > 0 && Header::block_alignment % static_cast<std::uint64_t>(page_size) == 0)
+        {
+            void * const mapping = ::mmap(nullptr, data_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                                          static_cast<off_t>(data_offset_));
+            if (mapping == MAP_FAILED)
+            {
+                detail::throw_errno("mmap");
+            }
+            data_ = std::shared_ptr<char>(static_cast<char *>(mapping), [data_size](char * ptr)
+            {
+                ::munmap(ptr, data_size);
+            });
+        }
+        else
+        {
+            data_ = std::shared_ptr<char>(
+                static_cast<char *>(::operator new[](data_size, std::align_val_t(Header::block_alignment))),
+                [](char * ptr)
+                {
+                    ::operator delete[](ptr, std::align_val_t(Header::block_alignment));
+                });
+            ::posix_fadvise(fd, static_cast<off_t>(data_offset_), static_cast<off_t>(data_size), POSIX_FADV_SEQUENTIAL);
+            for (std::uint64_t done = 0; done < data_size;)
+            {
+                ssize_t const count = ::pread(fd, data_.get() + done, data_size - done, static_cast<off_t>(data_offset_ + done));
+                if (count < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (count < 0)
+                {
+                    detail::throw_errno("read");
+                }
+                if (count == 0)
+                {
+                    throw std::runtime_error("SOA checkpoint is corrupt");
+                }
+                done += static_cast<std::uint64_t>(count);
+            }
+        }
+    }
+
+    /*!
+     * @return The name of an entry.
+     */
+    std::string_view name(detail::CheckpointEntry const & entry) const noexcept
+    {
+        return std::string_view(names_).substr(entry.name_offset, entry.name_size);
+    }
+
+    // Member variables:
+    std::vector<detail::CheckpointEntry> entries_;
+    std::vector<detail::CheckpointColumn> columns_;
+    std::string names_;
+    std::vector<bool> restored_;
+    std::uint64_t data_offset_ = 0;
+    std::shared_ptr<char> data_;
+};
+
+/*!
+ * Immutable, compressed column of arithmetic values with block-wise random
+ * access.
+ *
+ * Values are split into blocks of 'block_size'. Each block is stored with
+ * the codec that needs fewer bits per value:
+ * - frame of reference: the offset of each value from the block minimum;
+ * - delta: the difference of each value from its predecessor, relative to
+ *   the smallest difference, for monotonic or slowly changing columns.
+ * The offsets are then bit-packed with the smallest width that fits them.
+ *
+ * Bit-packing interleaves 'lanes' independent streams of words, so every
+ * lane of a group of values uses the same shifts. That lets the compiler
+ * vectorize decoding. Floating point values are compressed by their bit
+ * patterns, which only helps if they repeat or vary little.
+ */
+template <typename T>
+class CompressedColumn
+{
+    static_assert(std::is_arithmetic_v<T> && sizeof(T) <= 8, "Compressed columns support arithmetic types of up to 64 bits");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    static constexpr size_type block_size = 1024;
+    static constexpr size_type lanes = 4;
+
+    /*!
+     * The codec of a block.
+     */
+    enum class Codec : std::uint8_t
+    {
+        frame_of_reference,
+        delta,
+    };
+
+    /*!
+     * Default constructor. Creates an empty column.
+     */
+    CompressedColumn() = default;
+
+    /*!
+     * Compress values.
+     *
+     * @param values The values.
+     */
+    explicit CompressedColumn(std::span<T const> values) :
+        size_(values.size())
+    {
+        std::array<std::uint64_t, block_size> offsets;
+        blocks_.reserve((values.size() + block_size - 1) / block_size);
+        for (size_type first = 0; first < values.size(); first += block_size)
+        {
+            this->compress_block(values.subspan(first, std::min(block_size, values.size() - first)), offsets);
+        }
+    }
+
+    /*!
+     * @return The number of values.
+     */
+    size_type size() const noexcept
+    {
+        return size_;
+    }
+
+    /*!
+     * @return True if the column has no values.
+     */
+    bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    /*!
+     * @return The number of blocks.
+     */
+    size_type block_count() const noexcept
+    {
+        return blocks_.size();
+    }
+
+    /*!
+     * @return The number of bytes used by the compressed values and block
+     *      headers.
+     */
+    size_type compressed_bytes() const noexcept
+    {
+        return words_.size() * sizeof(std::uint64_t) + blocks_.size() * sizeof(Block);
+    }
+
+    /*!
+     * @param block The index of a block.
+     * @return The codec of the block.
+     */
+    Codec codec(size_type block) const noexcept
+    {
+        assert(block < blocks_.size());
+        return blocks_[block].codec;
+    }
+
+    /*!
+     * @param block The index of a block.
+     * @return The number of bits per value in the block.
+     */
+    unsigned bit_width(size_type block) const noexcept
+    {
+        assert(block < blocks_.size());
+        return blocks_[block].width;
+    }
+
+    /*!
+     * Get a value. Constant time for frame of reference blocks; delta
+     * blocks decode the values before it in the block.
+     *
+     * @param index The index of the value.
+     * @return The value.
+     */
+    T get(size_type index) const noexcept
+    {
+        assert(index < size_);
+        Block const & block = blocks_[index / block_size];
+        size_type const position = index % block_size;
+        if (block.codec == Codec::frame_of_reference)
+        {
+            return decode_value(block.reference + this->unpack(block, position));
+        }
+
+        std::uint64_t value = block.first;
+        for (size_type i = 1; i <= position; ++i)
+        {
+            value += this->unpack(block, i) + block.reference;
+        }
+        return decode_value(value);
+    }
+
+    /*!
+     * Decode a block.
+     *
+     * @param block The index of the block.
+     * @param out The buffer to decode into.
+     * @return The number of values in the block, which were written to the
+     *      start of 'out'.
+     */
+    size_type decode_block(size_type block, std::span<T, block_size> out) const noexcept
+    {
+        assert(block < blocks_.size());
+        Block const & header = blocks_[block];
+        std::array<std::uint64_t, block_size> offsets;
+        this->unpack_all(header, offsets);
+
+        size_type const count = std::min(block_size, size_ - block * block_size);
+        if (header.codec == Codec::frame_of_reference)
+        {
+            for (size_type i = 0; i < count; ++i)
+            {
+                out[i] = decode_value(header.reference + offsets[i]);
+            }
+        }
+        else
+        {
+            std::uint64_t value = header.first;
+            out[0] = decode_value(value);
+            for (size_type i = 1; i < count; ++i)
+            {
+                value += offsets[i] + header.reference;
+                out[i] = decode_value(value);
+            }
+        }
+        return count;
+    }
+
+    /*!
+     * Decode all values.
+     *
+     * @param out The buffer to decode into, of at least 'size()' elements.
+     */
+    void decode(std::span<T> out) const noexcept
+    {
+        assert(out.size() >= size_);
+        this->scan([&](std::span<T const> values, size_type first)
+        {
+            std::copy(values.begin(), values.end(), out.begin() + first);
+        });
+    }
+
+    /*!
+     * Decode the blocks one by one and call a function for each.
+     *
+     * @param func Function taking the values of a block as a
+     *      'std::span<T const>' and the index of its first value.
+     */
+    template <typename Func>
+    void scan(Func && func) const
+    {
+        std::array<T, block_size> values;
+        for (size_type block = 0; block < blocks_.size(); ++block)
+        {
+            size_type const count = this->decode_block(block, values);
+            func(std::span<T const>(values.data(), count), block * block_size);
+        }
+    }
+
+private:
+    /*!
+     * Header of a block.
+     */
+    struct Block
+    {
+        // The first value, for delta blocks.
+        std::uint64_t first;
+        // The block minimum, or the smallest difference for delta blocks.
+        std::uint64_t reference;
+        // The offset of the block's words in 'words_'.
+        std::uint64_t word_offset;
+        Codec codec;
+        std::uint8_t width;
+    };
+
+    /*!
+     * Map a value to an unsigned integer, preserving the order of integers.
+     */
+    static std::uint64_t encode_value(T value) noexcept
+    {
+        if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+        {
+            return static_cast<std::uint64_t>(static_cast<std::int64_t>(value)) ^ (std::uint64_t(1) << 63);
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            return static_cast<std::uint64_t>(value);
+        }
+        else
+        {
+            using Bits = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+            return std::bit_cast<Bits>(value);
+        }
+    }
+
+    /*!
+     * Map an unsigned integer back to a value.
+     */
+    static T decode_value(std::uint64_t value) noexcept
+    {
+        if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+        {
+            return static_cast<T>(static_cast<std::int64_t>(value ^ (std::uint64_t(1) << 63)));
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            return static_cast<T>(value);
+        }
+        else
+        {
+            using Bits = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+            return std::bit_cast<T>(static_cast<Bits>(value));
+        }
+    }
+
+    /*!
+     * Choose a codec for a block, and bit-pack it.
+     */
+    void compress_block(std::span<T const> values, std::array<std::uint64_t, block_size> & offsets)
+    {
+        // The codec and width are chosen from the values of the block only;
+        // the offsets of a partial block are padded with zeros, which fit any
+        // width and are never decoded.
+        size_type const count = values.size();
+        std::array<std::uint64_t, block_size> encoded;
+        for (size_type i = 0; i < count; ++i)
+        {
+            encoded[i] = encode_value(values[i]);
+        }
+
+        auto const [min, max] = std::minmax_element(encoded.begin(), encoded.begin() + count);
+        std::int64_t min_delta = 0;
+        std::int64_t max_delta = 0;
+        for (size_type i = 1; i < count; ++i)
+        {
+            std::int64_t const delta = static_cast<std::int64_t>(encoded[i] - encoded[i - 1]);
+            min_delta = i == 1 ? delta : std::min(min_delta, delta);
+            max_delta = i == 1 ? delta : std::max(max_delta, delta);
+        }
+        unsigned const reference_width = std::bit_width(*max - *min);
+        unsigned const delta_width = std::bit_width(static_cast<std::uint64_t>(max_delta) - static_cast<std::uint64_t>(min_delta));
+
+        Block block{};
+        block.first = encoded[0];
+        block.word_offset = words_.size();
+        if (delta_width < reference_width)
+        {
+            block.codec = Codec::delta;
+            block.width = static_cast<std::uint8_t>(delta_width);
+            block.reference = static_cast<std::uint64_t>(min_delta);
+            offsets[0] = 0;
+            for (size_type i = 1; i < count; ++i)
+            {
+                offsets[i] = encoded[i] - encoded[i - 1] - block.reference;
+            }
+        }
+        else
+        {
+            block.codec = Codec::frame_of_reference;
+            block.width = static_cast<std::uint8_t>(reference_width);
+            block.reference = *min;
+            for (size_type i = 0; i < count; ++i)
+            {
+                offsets[i] = encoded[i] - block.reference;
+            }
+        }
+        std::fill(offsets.begin() + count, offsets.end(), 0);
+
+        // Each lane holds block_size / lanes values of 'width' bits, i.e.
+        // width * block_size / lanes / 64 words.
+        unsigned const width = block.width;
+        words_.resize(words_.size() + width * block_size / 64);
+        std::uint64_t * const words = words_.data() + block.word_offset;
+        for (size_type i = 0; i < block_size / lanes && width > 0; ++i)
+        {
+            size_type const bit = i * width;
+            size_type const word = bit / 64;
+            unsigned const shift = bit % 64;
+            for (size_type lane = 0; lane < lanes; ++lane)
+            {
+                std::uint64_t const offset = offsets[i * lanes + lane];
+                words[word * lanes + lane] |= offset << shift;
+                if (shift + width > 64)
+                {
+                    words[(word + 1) * lanes + lane] |= offset >> (64 - shift);
+                }
+            }
+        }
+        blocks_.push_back(block);
+    }
+
+    /*!
+     * Unpack one offset of a block.
+     */
+    std::uint64_t unpack(Block const & block, size_type position) const noexcept
+    {
+        unsigned const width = block.width;
+        if (width == 0)
+        {
+            return 0;
+        }
+        std::uint64_t const * const words = words_.data() + block.word_offset;
+        size_type const lane = position % lanes;
+        size_type const bit = position / lanes * width;
+        size_type const word = bit / 64;
+        unsigned const shift = bit % 64;
+        std::uint64_t const mask = width == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << width) - 1;
+        std::uint64_t offset = words[word * lanes + lane] >> shift;
+        if (shift + width > 64)
+        {
+            offset |= words[(word + 1) * lanes + lane] << (64 - shift);
+        }
+        return offset & mask;
+    }
+
+    /*!
+     * Unpack all offsets of a block. The lanes use the same shifts, so the
+     * inner loop is vectorized.
+     */
+    void unpack_all(Block const & block, std::array<std::uint64_t, block_size> & offsets) const noexcept
+    {
+        unsigned const width = block.width;
+        if (width == 0)
+        {
+            offsets.fill(0);
+            return;
+        }
+        std::uint64_t const * const words = words_.data() + block.word_offset;
+        std::uint64_t const mask = width == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << width) - 1;
+        for (size_type i = 0; i < block_size / lanes; ++i)
+        {
+            size_type const bit = i * width;
+            size_type const word = bit / 64;
+            unsigned const shift = bit % 64;
+            std::uint64_t const * const low = words + word * lanes;
+            std::uint64_t * const out = offsets.data() + i * lanes;
+            if (shift + width > 64)
+            {
+                std::uint64_t const * const high = low + lanes;
+                for (size_type lane = 0; lane < lanes; ++lane)
+                {
+                    out[lane] = ((low[lane] >> shift) | (high[lane] << (64 - shift))) & mask;
+                }
+            }
+            else
+            {
+                for (size_type lane = 0; lane < lanes; ++lane)
+                {
+                    out[lane] = (low[lane] >> shift) & mask;
+                }
+            }
+        }
+    }
+
+    // Member variables:
+    std::vector<Block> blocks_;
+    std::vector<std::uint64_t> words_;
+    size_type size_ = 0;
+};
+
+/*!
+ * Frozen, compressed copy of a SOA vector, with one 'CompressedColumn' per
+ * array.
+ *
+ * Meant for large, read-mostly tables such as timestamps and ids. Rows are
+ * read by index, scanned block by block, or decompressed back into a
+ * 'SOAVector'.
+ */
+template <typename... Types>
+class CompressedSOAVector
+{
+public:
+    using size_type = std::size_t;
+
+    static constexpr size_type block_size = CompressedColumn<int>::block_size;
+
+    /*!
+     * Default constructor. Creates an empty vector.
+     */
+    CompressedSOAVector() = default;
+
+    /*!
+     * Compress the rows of a vector or span.
+     *
+     * @param rows The rows to compress.
+     */
+    explicit CompressedSOAVector(SOASpan<Types const...> rows) :
+        size_(rows.size())
+    {
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            ((std::get<TypeIndices>(columns_) = CompressedColumn<Types>(rows.template span<TypeIndices>())), ...);
+        }(std::index_sequence_for<Types...>{});
+    }
+
+    /*!
+     * @return The number of rows.
+     */
+    size_type size() const noexcept
+    {
+        return size_;
+    }
+
+    /*!
+     * @return True if there are no rows.
+     */
+    bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    /*!
+     * @return The number of bytes used by the compressed columns.
+     */
+    size_type compressed_bytes() const noexcept
+    {
+        return std::apply([](auto const &... columns) { return (columns.compressed_bytes() + ... + 0); }, columns_);
+    }
+
+    /*!
+     * Get a compressed column.
+     *
+     * @tparam TypeIndex The index of the column.
+     * @return The column.
+     */
+    template <std::size_t TypeIndex>
+    auto const & column() const noexcept
+    {
+        return std::get<TypeIndex>(columns_);
+    }
+
+    /*!
+     * Get the element of a certain column at a given index.
+     *
+     * @tparam TypeIndex The index of the column.
+     * @param index The index.
+     * @return The value.
+     */
+    template <std::size_t TypeIndex>
+    auto get(size_type index) const noexcept
+    {
+        return std::get<TypeIndex>(columns_).get(index);
+    }
+
+    /*!
+     * Decode the rows block by block and call a function for each block.
+     *
+     * @param func Function taking the rows of a block as a
+     *      'SOASpan<Types const...>' and the index of its first row.
+     */
+    template <typename Func>
+    void scan(Func && func) const
+    {
+        std::tuple<std::array<Types, block_size>...> buffers;
+        size_type const block_count = (size_ + block_size - 1) / block_size;
+        for (size_type block = 0; block < block_count; ++block)
+        {
+            size_type const count = std::min(block_size, size_ - block * block_size);
+            [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+            {
+                (std::get<TypeIndices>(columns_).decode_block(block, std::get<TypeIndices>(buffers)), ...);
+                func(SOASpan<Types const...>(count, std::get<TypeIndices>(buffers).data()...), block * block_size);
+            }(std::index_sequence_for<Types...>{});
+        }
+    }
+
+    /*!
+     * Decompress all rows.
+     *
+     * @return A vector with the rows.
+     */
+    SOAVector<Types...> decompress() const
+    {
+        SOAVector<Types...> vec;
+        vec.resize(size_);
+        [&]<std::size_t... TypeIndices>(std::index_sequence<TypeIndices...>)
+        {
+            (std::get<TypeIndices>(columns_).decode(vec.template span<TypeIndices>()), ...);
+        }(std::index_sequence_for<Types...>{});
+        return vec;
+    }
+
+private:
+    // Member variables:
+    std::tuple<CompressedColumn<Types>...> columns_;
+    size_type size_ = 0;
+};
+
+/*!
+ * Code of a string in a 'StringDictionary'.
+ *
+ * Stored in a SOA array instead of 'std::string', a dictionary-encoded
+ * column takes 4 bytes per row and no heap allocation, and compares and
+ * groups by integer.
+ */
+struct DictionaryCode
+{
+    std::uint32_t value = 0;
+
+    friend auto operator<=>(DictionaryCode, DictionaryCode) = default;
+};
+
+/*!
+ * Dictionary assigning dense codes to distinct strings, in the order they
+ * are first interned.
+ *
+ * Shared by all rows of a dictionary-encoded column, or by several columns.
+ * Strings are stored once, and their views stay valid as the dictionary
+ * grows. Interning is not thread safe; concurrent lookups are.
+ */
+class StringDictionary
+{
+public:
+    using size_type = std::size_t;
+
+    /*!
+     * Default constructor. Creates an empty dictionary.
+     */
+    StringDictionary() = default;
+
+    StringDictionary(StringDictionary const &) = delete;
+    StringDictionary & operator=(StringDictionary const &) = delete;
+    StringDictionary(StringDictionary &&) = default;
+    StringDictionary & operator=(StringDictionary &&) = default;
+
+    /*!
+     * Get the code of a string, adding the string if it is new.
+     *
+     * @param string The string.
+     * @return The code of the string.
+     * @throws std::length_error if the dictionary is full.
+     */
+    DictionaryCode intern(std::string_view string)
+    {
+        auto const it = codes_.find(string);
+        if (it != codes_.end())
+        {
+            return it->second;
+        }
+        if (strings_.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::length_error("String dictionary is full");
+        }
+
+        DictionaryCode const code{static_cast<std::uint32_t>(strings_.size())};
+        std::string const & stored = strings_.emplace_back(string);
+        codes_.emplace(stored, code);
+        return code;
+    }
+
+    /*!
+     * Get the code of a string without adding it.
+     *
+     * @param string The string.
+     * @return The code of the string, or nothing if it is not in the
+     *      dictionary.
+     */
+    std::optional<DictionaryCode> find(std::string_view string) const
+    {
+        auto const it = codes_.find(string);
+        if (it == codes_.end())
+        {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    /*!
+     * Get the string of a code.
+     *
+     * @param code The code.
+     * @return The string.
+     */
+    std::string_view string(DictionaryCode code) const noexcept
+    {
+        assert(code.value < strings_.size());
+        return strings_[code.value];
+    }
+
+    /*!
+     * @return The number of distinct strings, i.e. one past the largest code.
+     */
+    size_type size() const noexcept
+    {
+        return strings_.size();
+    }
+
+private:
+    // Member variables:
+    // A deque never moves its elements, so the views in 'codes_' stay valid.
+    std::deque<std::string> strings_;
+    std::unordered_map<std::string_view, DictionaryCode> codes_;
+};
+
+/*!
+ * Find the rows of a dictionary-encoded column equal to a code.
+ *
+ * Compares integer codes without branching on the result.
+ *
+ * @param codes The column.
+ * @param code The code to compare with.
+ * @return The indices of the matching rows, in increasing order.
+ */
+inline std::vector<std::size_t> filter_equal(std::span<DictionaryCode const> codes, DictionaryCode code)
+{
+    std::vector<std::size_t> rows(codes.size());
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < codes.size(); ++i)
+    {
+        rows[count] = i;
+        count += codes[i] == code;
+    }
+    rows.resize(count);
+    return rows;
+}
+
+/*!
+ * Find the rows of a dictionary-encoded column equal to a string. The
+ * string is looked up once, then only codes are compared.
+ *
+ * @param codes The column.
+ * @param dictionary The dictionary of the column.
+ * @param string The string to compare with.
+ * @return The indices of the matching rows, in increasing order.
+ */
+inline std::vector<std::size_t> filter_equal(std::span<DictionaryCode const> codes, StringDictionary const & dictionary,
+                                             std::string_view string)
+{
+    std::optional<DictionaryCode> const code = dictionary.find(string);
+    return code ? filter_equal(codes, *code) : std::vector<std::size_t>();
+}
+
+/*!
+ * Count the rows per code of a dictionary-encoded column.
+ *
+ * @param codes The column.
+ * @param code_count The number of codes, i.e. the size of the dictionary.
+ * @return The number of rows of each code, indexed by code.
+ */
+inline std::vector<std::size_t> group_count(std::span<DictionaryCode const> codes, std::size_t code_count)
+{
+    std::vector<std::size_t> counts(code_count, 0);
+    for (DictionaryCode const code : codes)
+    {
+        assert(code.value < code_count);
+        ++counts[code.value];
+    }
+    return counts;
+}
+
+/*!
+ * Sum the values of a column per code of a dictionary-encoded column. The
+ * codes index a dense array of sums, so no hashing is involved.
+ *
+ * @param codes The column to group by.
+ * @param values The column to sum, of the same size.
+ * @param code_count The number of codes, i.e. the size of the dictionary.
+ * @return The sum of the values of each code, indexed by code.
+ */
+template <typename T>
+std::vector<std::remove_const_t<T>> group_sum(std::span<DictionaryCode const> codes, std::span<T> values,
+                                             std::size_t code_count)
+{
+    assert(codes.size() == values.size());
+    std::vector<std::remove_const_t<T>> sums(code_count, std::remove_const_t<T>());
+    for (std::size_t i = 0; i < codes.size(); ++i)
+    {
+        assert(codes[i].value < code_count);
+        sums[codes[i].value] += values[i];
+    }
+    return sums;
+}
+
+/*!
+ * Count the set flags of a packed array.
+ *
+ * @param mask The words of the array, e.g. from 'SOAVector::span()'.
+ * @return The number of set flags.
+ */
+inline std::size_t mask_count(std::span<PackedBool const> mask) noexcept
+{
+    std::size_t count = 0;
+    for (PackedBool const word : mask)
+    {
+        count += std::popcount(word.word);
+    }
+    return count;
+}
+
+/*!
+ * Combine two packed arrays of the same size with a logical and.
+ *
+ * Processes 128 rows at a time with SSE2 where available.
+ *
+ * @param lhs The first array.
+ * @param rhs The second array.
+ * @param result The words to store the result in. May be one of the inputs.
+ */
+inline void mask_and(std::span<PackedBool const> lhs, std::span<PackedBool const> rhs,
+                     std::span<PackedBool> result) noexcept
+{
+    assert(lhs.size() == rhs.size() && lhs.size() == result.size());
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 2 <= lhs.size(); i += 2)
+    {
+        __m128i const a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(lhs.data() + i));
+        __m128i const b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(rhs.data() + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(result.data() + i), _mm_and_si128(a, b));
+    }
+#endif
+    for (; i < lhs.size(); ++i)
+    {
+        result[i].word = lhs[i].word & rhs[i].word;
+    }
+}
+
+/*!
+ * Combine two packed arrays of the same size with a logical or.
+ *
+ * Processes 128 rows at a time with SSE2 where available.
+ *
+ * @param lhs The first array.
+ * @param rhs The second array.
+ * @param result The words to store the result in. May be one of the inputs.
+ */
+inline void mask_or(std::span<PackedBool const> lhs, std::span<PackedBool const> rhs,
+                    std::span<PackedBool> result) noexcept
+{
+    assert(lhs.size() == rhs.size() && lhs.size() == result.size());
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 2 <= lhs.size(); i += 2)
+    {
+        __m128i const a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(lhs.data() + i));
+        __m128i const b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(rhs.data() + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(result.data() + i), _mm_or_si128(a, b));
+    }
+#endif
+    for (; i < lhs.size(); ++i)
+    {
+        result[i].word = lhs[i].word | rhs[i].word;
+    }
+}
+
+/*!
+ * Invert the flags of a packed array.
+ *
+ * Processes 128 rows at a time with SSE2 where available. The bits past the
+ * last row stay zero.
+ *
+ * @param mask The array.
+ * @param size The number of rows of the array.
+ * @param result The words to store the result in. May be the input.
+ */
+inline void mask_not(std::span<PackedBool const> mask, std::size_t size, std::span<PackedBool> result) noexcept
+{
+    assert(mask.size() == PackedBool::word_count(size) && mask.size() == result.size());
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    __m128i const ones = _mm_set1_epi32(-1);
+    for (; i + 2 <= mask.size(); i += 2)
+    {
+        __m128i const a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(mask.data() + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(result.data() + i), _mm_xor_si128(a, ones));
+    }
+#endif
+    for (; i < mask.size(); ++i)
+    {
+        result[i].word = ~mask[i].word;
+    }
+    if (size % PackedBool::bits != 0)
+    {
+        result.back().word &= (std::uint64_t(1) << (size % PackedBool::bits)) - 1;
+    }
+}
+
+/*!
+ * Set the flags of a packed array to the result of a predicate on the
+ * values of a column.
+ *
+ * Assembles each word from 64 predicate results without branching on them.
+ *
+ * @param values The column.
+ * @param predicate The predicate, called with each value.
+ * @param result The words of an array of the same size as the column.
+ */
+template <typename T, typename Predicate>
+void mask_where(std::span<T> values, Predicate predicate, std::span<PackedBool> result)
+{
+    assert(result.size() == PackedBool::word_count(values.size()));
+    for (std::size_t word = 0; word < result.size(); ++word)
+    {
+        std::size_t const first = word * PackedBool::bits;
+        std::size_t const last = std::min(first + PackedBool::bits, values.size());
+        std::uint64_t bits = 0;
+        for (std::size_t i = first; i < last; ++i)
+        {
+            bits |= std::uint64_t(static_cast<bool>(predicate(values[i]))) << (i - first);
+        }
+        result[word].word = bits;
+    }
+}
+
+/*!
+ * Get the rows whose flag is set in a packed array, e.g. to use the result
+ * of 'mask_where()' as a filter. Skips 64 unset rows at a time.
+ *
+ * @param mask The words of the array.
+ * @return The indices of the set flags, in increasing order.
+ */
+inline std::vector<std::size_t> mask_rows(std::span<PackedBool const> mask)
+{
+    std::vector<std::size_t> rows;
+    rows.reserve(mask_count(mask));
+    for (std::size_t word = 0; word < mask.size(); ++word)
+    {
+        for (std::uint64_t bits = mask[word].word; bits != 0; bits &= bits - 1)
+        {
+            rows.push_back(word * PackedBool::bits + std::countr_zero(bits));
+        }
+    }
+    return rows;
+}
+
+/*!
+ * Sum the values of a column in the rows whose flag is set in a packed
+ * array. Words with no flag set are skipped and words with all flags set
+ * are summed without testing the flags.
+ *
+ * @param mask The words of the array.
+ * @param values The column, of the same size as the array.
+ * @return The sum of the selected values.
+ */
+template <typename T>
+std::remove_const_t<T> masked_sum(std::span<PackedBool const> mask, std::span<T> values)
+{
+    using Value = std::remove_const_t<T>;
+    assert(mask.size() == PackedBool::word_count(values.size()));
+    Value sum = Value();
+    for (std::size_t word = 0; word < mask.size(); ++word)
+    {
+        std::uint64_t const bits = mask[word].word;
+        if (bits == 0)
+        {
+            continue;
+        }
+        std::size_t const first = word * PackedBool::bits;
+        std::size_t const last = std::min(first + PackedBool::bits, values.size());
+        if (bits == ~std::uint64_t(0))
+        {
+            for (std::size_t i = first; i < last; ++i)
+            {
+                sum += values[i];
+            }
+        }
+        else
+        {
+            for (std::size_t i = first; i < last; ++i)
+            {
+                sum += (bits >> (i - first) & 1) ? values[i] : Value();
+            }
+        }
+    }
+    return sum;
+}
+
+namespace detail
+{
+    /*!
+     * Call a function with each value of a 'Nullable' array that is not
+     * null, 64 rows per word of the validity bitmap: words without values
+     * are skipped and the rows of words without nulls are visited without
+     * testing their bits.
+     *
+     * @param values The values of the array.
+     * @param validity The validity bitmap of the array.
+     * @param func The function to call with each value.
+     */
+    template <typename T, typename Func>
+    void for_each_valid(std::span<T> values, std::span<PackedBool const> validity, Func && func)
+    {
+        assert(validity.size() == PackedBool::word_count(values.size()));
+        for (std::size_t word = 0; word < validity.size(); ++word)
+        {
+            std::uint64_t const bits = validity[word].word;
+            std::size_t const first = word * PackedBool::bits;
+            if (bits == ~std::uint64_t(0))
+            {
+                for (std::size_t i = first; i < first + PackedBool::bits; ++i)
+                {
+                    func(values[i].value);
+                }
+                continue;
+            }
+            for (std::uint64_t rest = bits; rest != 0; rest &= rest - 1)
+            {
+                func(values[first + std::countr_zero(rest)].value);
+            }
+        }
+    }
+}
+
+/*!
+ * Sum the values of a 'Nullable' array, skipping nulls.
+ *
+ * @param values The values of the array, e.g. from 'SOAVector::span()'.
+ * @param validity The validity bitmap of the array, from
+ *      'SOAVector::validity()'.
+ * @return The sum of the values that are not null, zero if all are.
+ */
+template <typename T>
+typename std::remove_const_t<T>::value_type nullable_sum(std::span<T> values, std::span<PackedBool const> validity)
+{
+    using Value = typename std::remove_const_t<T>::value_type;
+    Value sum = Value();
+    detail::for_each_valid(values, validity, [&sum](Value const & value) { sum += value; });
+    return sum;
+}
+
+/*!
+ * Get the smallest value of a 'Nullable' array, skipping nulls.
+ *
+ * @param values The values of the array.
+ * @param validity The validity bitmap of the array.
+ * @return The smallest value that is not null, or 'std::nullopt' if all
+ *      are null.
+ */
+template <typename T>
+std::optional<typename std::remove_const_t<T>::value_type> nullable_min(std::span<T> values,
+                                                                        std::span<PackedBool const> validity)
+{
+    using Value = typename std::remove_const_t<T>::value_type;
+    std::optional<Value> min;
+    detail::for_each_valid(values, validity, [&min](Value const & value)
+    {
+        if (!min || value < *min)
+        {
+            min = value;
+        }
+    });
+    return min;
+}
+
+/*!
+ * Get the largest value of a 'Nullable' array, skipping nulls.
+ *
+ * @param values The values of the array.
+ * @param validity The validity bitmap of the array.
+ * @return The largest value that is not null, or 'std::nullopt' if all
+ *      are null.
+ */
+template <typename T>
+std::optional<typename std::remove_const_t<T>::value_type> nullable_max(std::span<T> values,
+                                                                        std::span<PackedBool const> validity)
+{
+    using Value = typename std::remove_const_t<T>::value_type;
+    std::optional<Value> max;
+    detail::for_each_valid(values, validity, [&max](Value const & value)
+    {
+        if (!max || *max < value)
+        {
+            max = value;
+        }
+    });
+    return max;
+}
+
+/*!
+ * Get the mean of the values of a 'Nullable' array, skipping nulls.
+ *
+ * The number of values is counted 64 rows at a time from the validity
+ * bitmap with 'mask_count()'.
+ *
+ * @param values The values of the array.
+ * @param validity The validity bitmap of the array.
+ * @return The mean of the values that are not null, or 'std::nullopt' if
+ *      all are null.
+ */
+template <typename T>
+std::optional<double> nullable_mean(std::span<T> values, std::span<PackedBool const> validity)
+{
+    std::size_t const count = mask_count(validity);
+    if (count == 0)
     {
-        return std::span<value_type<TypeIndex>>(this->data<TypeIndex>(), this->size_);
+        return std::nullopt;
     }
+    return static_cast<double>(nullable_sum(values, validity)) / static_cast<double>(count);
+}
 
+/*!
+ * Stress tests and benchmarks of the concurrent containers, run by the demo
+ * program with the argument "test" or "bench".
+ */
+namespace self_test
+{
     /*!
-     * Clears the contents, deleting all elements of all arrays.
+     * Receives the results of benchmark loops, so they are not optimized away.
+     */
+    inline volatile std::uint64_t benchmark_sink = 0;
+
+    /*!
+     * Stress test of 'SnapshotSOAVector': one writer appends rows through
+     * many reallocations while readers take snapshots and check that every
+     * row they see holds its own index.
      *
-     * Calling 'clear()' does not change the memory allocation and change the
-     * capacity.
+     * @param reader_count The number of reader threads.
+     * @param row_count The number of rows to append.
+     * @return True if all readers saw consistent rows.
      */
-    void clear()
+    inline bool test_snapshot_vector(std::size_t reader_count = 4, std::size_t row_count = 1 << 20)
     {
-        if (size_ > 0)
+        SnapshotSOAVector<std::uint64_t, double> vec(reader_count);
+        std::atomic<bool> done{false};
+        std::atomic<bool> failed{false};
+        std::atomic<std::size_t> snapshot_count{0};
+
+        std::vector<std::thread> readers;
+        for (std::size_t r = 0; r < reader_count; ++r)
         {
-            std::size_t type_index = 0;
-            (
-                (
-                    delete_elements<Types>(
-                        array_ptrs_[type_index],
-                        array_ptrs_[type_index] + size_ * sizeof(Types)),
-                    ++type_index
-                ),
-                ...
-            );
+            readers.emplace_back([&]
+            {
+                auto reader = vec.register_reader();
+                while (!done.load(std::memory_order_relaxed) && !failed.load(std::memory_order_relaxed))
+                {
+                    auto const snapshot = reader.snapshot();
+                    // Check a spread of rows, including the newest one.
+                    std::size_t const stride = snapshot.size() / 256 + 1;
+                    for (std::size_t i = snapshot.size() % stride; i < snapshot.size(); i += stride)
+                    {
+                        if (snapshot.get<0>(i) != i || snapshot.get<1>(i) != static_cast<double>(i))
+                        {
+                            failed = true;
+                        }
+                    }
+                    snapshot_count.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
         }
-        size_ = 0;
+
+        for (std::uint64_t i = 0; i < row_count; ++i)
+        {
+            vec.push_back(std::uint64_t(i), static_cast<double>(i));
+        }
+        done = true;
+        for (std::thread & reader : readers)
+        {
+            reader.join();
+        }
+        vec.reclaim();
+
+        bool const ok = !failed && vec.size() == row_count;
+        std::cout << "SnapshotSOAVector stress test: " << snapshot_count << " snapshots, "
+                  << (ok ? "passed" : "FAILED") << "\n";
+        return ok;
     }
 
     /*!
-     * Adds a set of elements at the end of each array.
+     * Measure the read throughput of 'SnapshotSOAVector' readers, which sum
+     * a column of a fresh snapshot over and over while a writer appends, and
+     * compare it with summing a plain 'SOAVector' of the same size.
      *
-     * @param args The elements to add.
+     * @param reader_count The number of reader threads.
+     * @param row_count The number of rows to read per snapshot.
+     * @param duration How long the readers run.
      */
-    void push_back(Types&&... args)
+    inline void benchmark_snapshot_vector(std::size_t reader_count = 4, std::size_t row_count = 1 << 20,
+                                          std::chrono::milliseconds duration = std::chrono::milliseconds(1000))
     {
-        // Grow the capacity if we have to.
-        if (size_ + 1 > capacity_)
+        using Clock = std::chrono::steady_clock;
+
+        SOAVector<std::uint64_t> plain;
+        SnapshotSOAVector<std::uint64_t> vec(reader_count);
+        for (std::uint64_t i = 0; i < row_count; ++i)
         {
-            this->reserve(this->size_ * growth_factor + 1);
+            plain.push_back(std::uint64_t(i));
+            vec.push_back(std::uint64_t(i));
         }
 
-        std::size_t type_index = 0;
-        (
-            (
-                create_element(array_ptrs_[type_index] + size_ * sizeof(Types), std::forward<decltype(args)>(args)),
-                ++type_index
-            ),
-            ...
-        );
-        ++size_;
-    }
+        // Baseline: one thread summing the plain vector.
+        std::uint64_t sum = 0;
+        std::size_t rows_read = 0;
+        Clock::time_point const plain_start = Clock::now();
+        while (Clock::now() - plain_start < duration)
+        {
+            for (std::uint64_t const value : std::as_const(plain).span<0>())
+            {
+                sum += value;
+            }
+            rows_read += row_count;
+        }
+        double const plain_seconds = std::chrono::duration<double>(Clock::now() - plain_start).count();
 
-    /*!
-     * Remove the last element of each array.
-     */
-    void pop_back()
-    {
-        assert(size_ > 0);
+        std::atomic<bool> done{false};
+        std::atomic<std::size_t> snapshot_rows{0};
+        std::atomic<std::uint64_t> snapshot_sum{0};
+        std::vector<std::thread> readers;
+        for (std::size_t r = 0; r < reader_count; ++r)
+        {
+            readers.emplace_back([&]
+            {
+                auto reader = vec.register_reader();
+                std::uint64_t local_sum = 0;
+                std::size_t local_rows = 0;
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    auto const snapshot = reader.snapshot();
+                    for (std::uint64_t const value : snapshot.rows().span<0>())
+                    {
+                        local_sum += value;
+                    }
+                    local_rows += snapshot.size();
+                }
+                snapshot_sum += local_sum;
+                snapshot_rows += local_rows;
+            });
+        }
 
-        std::size_t type_index = 0;
-        (
-            (
-                delete_element<Types>(array_ptrs_[type_index] + (size_ - 1) * sizeof(Types)),
-                ++type_index
-            ),
-            ...
-        );
-        --size_;
+        // The writer keeps appending, so readers race with reallocations.
+        Clock::time_point const start = Clock::now();
+        std::uint64_t next = row_count;
+        while (Clock::now() - start < duration)
+        {
+            vec.push_back(std::uint64_t(next++));
+        }
+        done = true;
+        for (std::thread & reader : readers)
+        {
+            reader.join();
+        }
+        double const seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        benchmark_sink = sum + snapshot_sum;
+
+        std::cout << "SnapshotSOAVector read throughput: "
+                  << static_cast<double>(rows_read) / plain_seconds / 1e6 << " M rows/s for a plain SOAVector, "
+                  << static_cast<double>(snapshot_rows) / seconds / 1e6 << " M rows/s for "
+                  << reader_count << " snapshot readers with " << next - row_count << " concurrent appends\n";
     }
 
     /*!
-     * Reserve storage.
+     * Make the index and value batches of a scatter-add workload.
      *
-     * @param new_capacity The new capacity of the arrays. Will only
-     *      reallocate if 'new_capacity' is larger than the current capacity.
+     * @param seed The seed of the pseudo-random indices.
+     * @param bin_count The number of elements the indices refer to.
+     * @param count The number of updates.
      */
-    void reserve(size_type new_capacity)
+    inline std::pair<std::vector<std::size_t>, std::vector<std::int64_t>> make_scatter_updates(
+        std::uint64_t seed, std::size_t bin_count, std::size_t count)
     {
-        if (new_capacity > capacity_)
+        std::vector<std::size_t> indices(count);
+        std::vector<std::int64_t> values(count);
+        std::uint64_t state = seed * 0x9E3779B97F4A7C15 + 1;
+        for (std::size_t i = 0; i < count; ++i)
         {
-            reallocate(new_capacity);
+            // xorshift64
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            indices[i] = state % bin_count;
+            values[i] = static_cast<std::int64_t>(state >> 60) + 1;
         }
+        return {std::move(indices), std::move(values)};
     }
 
     /*!
-     * Reduce the memory allocation to fit only the current size.
+     * Concurrent correctness test of 'SOAVector::scatter_add()': threads add
+     * batches to a shared histogram, once with batches dense enough to take
+     * the privatized path and once sparse enough to take the sorted path,
+     * and the result is compared with a sequential sum.
+     *
+     * @param thread_count The number of threads.
+     * @return True if both histograms are correct.
      */
-    void shrink_to_fit()
+    inline bool test_scatter_add(std::size_t thread_count = 4)
     {
-        if (capacity_ > size_)
+        bool ok = true;
+        // (bins, updates per batch): dense batches cover many bins, sparse ones few.
+        for (auto const & [bin_count, batch_size] : {std::pair<std::size_t, std::size_t>(1024, 8192),
+                                                   std::pair<std::size_t, std::size_t>(1 << 20, 512)})
         {
-            reallocate(size_);
+            SOAVector<std::int64_t> histogram(bin_count);
+            std::vector<std::int64_t> expected(bin_count, 0);
+            std::vector<std::pair<std::vector<std::size_t>, std::vector<std::int64_t>>> batches;
+            for (std::size_t batch = 0; batch < thread_count * 16; ++batch)
+            {
+                batches.push_back(make_scatter_updates(batch, bin_count, batch_size));
+                for (std::size_t i = 0; i < batch_size; ++i)
+                {
+                    expected[batches.back().first[i]] += batches.back().second[i];
+                }
+            }
+
+            std::vector<std::thread> threads;
+            for (std::size_t t = 0; t < thread_count; ++t)
+            {
+                threads.emplace_back([&, t]
+                {
+                    for (std::size_t batch = t; batch < batches.size(); batch += thread_count)
+                    {
+                        histogram.scatter_add<0>(batches[batch].first, batches[batch].second);
+                    }
+                });
+            }
+            for (std::thread & thread : threads)
+            {
+                thread.join();
+            }
+
+            bool const correct = std::ranges::equal(std::as_const(histogram).span<0>(), expected);
+            std::cout << "scatter_add " << (batch_size * 4 >= bin_count ? "dense" : "sparse") << " test: "
+                      << (correct ? "passed" : "FAILED") << "\n";
+            ok = ok && correct;
         }
+        return ok;
     }
 
-private:
     /*!
-     * Create a range of default initialized elements in existing memory allocation.
+     * Parse CSV text on one thread and on many, with quoted fields holding
+     * delimiters, newlines and escaped quotes across the chunk boundaries,
+     * and check that both give the same rows. Text with a quote inside an
+     * unquoted field must be rejected by both.
      *
-     * @param first The pointer to where the first element should be created.
-     * @param last The pointer to where one past the last last element should
-     *      be created.
+     * @param thread_count The number of threads of the parallel parse.
+     * @return True if both parses agree.
      */
-    template<typename T>
-    static void create_default_elements(char * const first, char * const last)
+    inline bool test_parse_csv(std::size_t thread_count = 8)
     {
-        for (char * it = first; it != last; it += sizeof(T))
+        std::string text = "id,name,score\n";
+        std::vector<std::string> names;
+        for (std::size_t i = 0; i < 1000; ++i)
         {
-            // Create a new default object in destination
-            new(it) T();
+            switch (i % 4)
+            {
+            case 0:
+                names.push_back("plain" + std::to_string(i));
+                text += std::to_string(i) + "," + names.back();
+                break;
+            case 1:
+                names.push_back("with,comma\nand newline " + std::to_string(i));
+                text += std::to_string(i) + ",\"with,comma\nand newline " + std::to_string(i) + "\"";
+                break;
+            case 2:
+                names.push_back("say \"" + std::to_string(i) + "\"\n");
+                text += std::to_string(i) + ",\"say \"\"" + std::to_string(i) + "\"\"\n\"";
+                break;
+            default:
+                names.push_back("");
+                text += std::to_string(i) + ",";
+                break;
+            }
+            text += "," + std::to_string(i) + ".5\n";
+        }
+
+        CsvOptions serial;
+        serial.threads = 1;
+        CsvOptions parallel;
+        parallel.threads = thread_count;
+        parallel.min_chunk_size = 1;
+
+        auto const equal = [](SOAVector<std::int64_t, std::string, double> const & a,
+                              SOAVector<std::int64_t, std::string, double> const & b)
+        {
+            return std::ranges::equal(a.span<0>(), b.span<0>()) && std::ranges::equal(a.span<1>(), b.span<1>())
+                && std::ranges::equal(a.span<2>(), b.span<2>());
+        };
+        auto const one = parse_csv<std::int64_t, std::string, double>(text, serial);
+        auto const many = parse_csv<std::int64_t, std::string, double>(text, parallel);
+        bool ok = equal(one, many) && std::ranges::equal(one.span<1>(), names);
+
+        // A stray quote anywhere in an unquoted field must fail both parses.
+        for (std::size_t const position : {text.size() / 7, text.size() / 2, text.size() - 1})
+        {
+            std::size_t const field = text.rfind("plain", position);
+            std::string bad = text;
+            bad.insert(field + 2, 1, '"');
+            for (CsvOptions const & options : {serial, parallel})
+            {
+                try
+                {
+                    parse_csv<std::int64_t, std::string, double>(bad, options);
+                    ok = false;
+                }
+                catch (std::runtime_error const &)
+                {
+                }
+            }
         }
+
+        std::cout << "parse_csv threads=1 vs threads=" << thread_count << " test: "
+                  << (ok ? "passed" : "FAILED") << "\n";
+        return ok;
     }
 
     /*!
-     * Create an element with a specific value in existing memory allocation.
+     * Create a 'SharedSOAVector' segment and attach to it read-only, once
+     * with the types it was created with and once each with a column of
+     * the same size but another type, with another column count and with
+     * the columns swapped. Only the first attach may succeed.
      *
-     * @param ptr The pointer to where the element should be created.
-     * @param value The value of the element.
+     * @return True if the mismatched attaches all threw.
      */
-    template<typename T>
-    static void create_element(char * const ptr, T&& value)
+    inline bool test_shared_vector_schema()
     {
-        new(ptr) T(std::forward<T>(value));
+        std::string const name = "/soa_self_test_" + std::to_string(::getpid());
+        SharedSOAVector<std::int32_t, double>::remove(name);
+        bool ok = true;
+        {
+            SharedSOAVector<std::int32_t, double> writer(name, 16);
+            writer.push_back(std::int32_t(42), 0.5);
+
+            SharedSOAVector<std::int32_t, double> const reader(name);
+            ok = reader.size() == 1 && reader.get<0>(0) == 42 && reader.get<1>(0) == 0.5;
+
+            auto const rejects = [&name]<typename... Other>(std::type_identity<SharedSOAVector<Other...>>)
+            {
+                try
+                {
+                    SharedSOAVector<Other...> const other(name);
+                    return false;
+                }
+                catch (std::runtime_error const &)
+                {
+                    return true;
+                }
+            };
+            ok = rejects(std::type_identity<SharedSOAVector<float, double>>{}) && ok;
+            ok = rejects(std::type_identity<SharedSOAVector<std::uint32_t, double>>{}) && ok;
+            ok = rejects(std::type_identity<SharedSOAVector<std::int32_t, std::int64_t>>{}) && ok;
+            ok = rejects(std::type_identity<SharedSOAVector<std::int32_t>>{}) && ok;
+            ok = rejects(std::type_identity<SharedSOAVector<double, std::int32_t>>{}) && ok;
+        }
+        SharedSOAVector<std::int32_t, double>::remove(name);
+
+        std::cout << "SharedSOAVector schema test: " << (ok ? "passed" : "FAILED") << "\n";
+        return ok;
     }
 
     /*!
-     * Delete an element at a specific location in existing memory allocation.
-     *
-     * @param ptr The pointer to the element.
+     * Advance a xorshift64 state and return it.
      */
-    template<typename T>
-    static void delete_element(char * const ptr)
+    inline std::uint64_t next_random(std::uint64_t & state) noexcept
     {
-        reinterpret_cast<T *>(ptr)->~T();
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
     }
 
     /*!
-     * Call destructor on a range of elements.
+     * Test a 'PackedBool' column against a 'std::vector<bool>': push_back,
+     * pop_back, resize both ways, assignment through the proxy reference,
+     * append(SOAVector &&) at a row that is not a multiple of 64,
+     * shrink_to_fit and copies. After every step the flags must match and
+     * the bits past the last row must be zero.
      *
-     * @param first The pointer to the first element to delete.
-     * @param last The pointer to one past the last element to delete.
+     * @return True if the column always matched.
      */
-    template<typename T>
-    static void delete_elements(char * const first, char * const last)
+    inline bool test_packed_bool()
     {
-        for (char * it = first; it != last; it += sizeof(T))
+        using Vec = SOAVector<PackedBool, std::int32_t>;
+        std::uint64_t state = 0x9E3779B97F4A7C15;
+        bool ok = true;
+
+        // The second column holds the row index, to check that rows stay together.
+        auto const check = [&ok](Vec const & vec, std::vector<bool> const & model)
         {
-            reinterpret_cast<T *>(it)->~T();
+            bool equal = vec.size() == model.size();
+            for (std::size_t i = 0; equal && i < model.size(); ++i)
+            {
+                equal = vec.get<0>(i) == model[i] && vec.get<1>(i) == static_cast<std::int32_t>(i);
+            }
+            std::span<PackedBool const> const words = vec.span<0>();
+            ok = ok && equal && words.size() == PackedBool::word_count(model.size())
+                && (model.size() % PackedBool::bits == 0 || words.back().word >> (model.size() % PackedBool::bits) == 0)
+                && mask_count(words) == static_cast<std::size_t>(std::ranges::count(model, true));
+        };
+
+        Vec vec;
+        std::vector<bool> model;
+        for (std::size_t i = 0; i < 1000; ++i)
+        {
+            model.push_back(next_random(state) % 2 != 0);
+            vec.push_back(model.back(), static_cast<std::int32_t>(i));
         }
-    }
+        check(vec, model);
 
-    /*!
-     * Copy a range of elements to a new location in an existing memory allocation.
-     *
-     * @param first A pointer to the first element to copy.
-     * @param last A pointer to one past the last element to copy.
-     * @param dst_first A pointer to the first element in the new location.
-     */
-    template<typename T>
-    static void copy_elements(char const * const first, char const * const last, char * dst_first)
-    {
-        for (char const * it = first; it != last; it += sizeof(T), dst_first += sizeof(T))
+        for (std::size_t i = 0; i < 37; ++i)
         {
-            T const * const original_obj_ptr = reinterpret_cast<T const *>(it);
-            // Create a new object in destination as a copy of original.
-            new(dst_first) T(*original_obj_ptr);
+            vec.pop_back();
+            model.pop_back();
+        }
+        check(vec, model);
+
+        vec.resize(637);
+        model.resize(637);
+        check(vec, model);
+        vec.resize(900);
+        model.resize(900, false);
+        for (std::size_t i = 637; i < 900; ++i)
+        {
+            vec.get<1>(i) = static_cast<std::int32_t>(i);
+        }
+        check(vec, model);
+
+        for (std::size_t n = 0; n < 200; ++n)
+        {
+            std::size_t const i = next_random(state) % model.size();
+            vec.get<0>(i) = !model[i];
+            model[i] = !model[i];
+        }
+        check(vec, model);
+
+        Vec other;
+        for (std::size_t i = 0; i < 333; ++i)
+        {
+            model.push_back(next_random(state) % 2 != 0);
+            other.push_back(model.back(), static_cast<std::int32_t>(900 + i));
         }
+        vec.append(std::move(other));
+        ok = ok && other.empty();
+        check(vec, model);
+
+        vec.shrink_to_fit();
+        ok = ok && vec.capacity() == vec.size();
+        check(vec, model);
+        for (std::size_t i = model.size(); i < 1300; ++i)
+        {
+            model.push_back(next_random(state) % 2 != 0);
+            vec.push_back(model.back(), static_cast<std::int32_t>(i));
+        }
+        check(vec, model);
+
+        Vec copy(vec);
+        Vec assigned;
+        assigned = vec;
+        check(copy, model);
+        check(assigned, model);
+        copy.pop_back();
+        assigned.resize(10);
+        check(vec, model);
+
+        std::cout << "PackedBool column test: " << (ok ? "passed" : "FAILED") << "\n";
+        return ok;
     }
 
     /*!
-     * Move a range of elements to a new location in an existing memory allocation.
+     * Test a 'Nullable' column against a 'std::vector<std::optional<T>>':
+     * push_back, pop_back, resize both ways, nulling rows through the
+     * validity bitmap, append(SOAVector &&) at a row that is not a multiple
+     * of 64, shrink_to_fit and copies. After every step the values and
+     * nulls must match and the bits past the last row must be zero.
      *
-     * @param first A pointer to the first element to move.
-     * @param last A pointer to one past the last element to move.
-     * @param dst_first A pointer to the first element in the new location.
+     * @return True if the column always matched.
      */
-    template<typename T>
-    static void move_elements(char * const first, char * const last, char * dst_first)
+    inline bool test_nullable()
     {
-        for (char * it = first; it != last; it += sizeof(T), dst_first += sizeof(T))
+        using Vec = SOAVector<Nullable<std::int64_t>, std::int32_t>;
+        std::uint64_t state = 0x9E3779B97F4A7C15;
+        bool ok = true;
+
+        auto const random_value = [&state]
         {
-            T * const original_obj_ptr = reinterpret_cast<T *>(it);
-            // Create a new object in destination, possibly by invoking move constructor.
-            new(dst_first) T(std::move(*original_obj_ptr));
-            // Delete the previous object
-            original_obj_ptr->~T();
+            std::uint64_t const random = next_random(state);
+            return random % 3 == 0 ? std::optional<std::int64_t>() : std::optional<std::int64_t>(random >> 40);
+        };
+
+        // The second column holds the row index, to check that rows stay together.
+        auto const check = [&ok](Vec const & vec, std::vector<std::optional<std::int64_t>> const & model)
+        {
+            bool equal = vec.size() == model.size();
+            std::int64_t sum = 0;
+            for (std::size_t i = 0; equal && i < model.size(); ++i)
+            {
+                equal = vec.get<0>(i) == model[i] && vec.get<1>(i) == static_cast<std::int32_t>(i);
+                sum += model[i].value_or(0);
+            }
+            std::span<PackedBool const> const validity = vec.validity<0>();
+            ok = ok && equal && validity.size() == PackedBool::word_count(model.size())
+                && (model.size() % PackedBool::bits == 0 || validity.back().word >> (model.size() % PackedBool::bits) == 0)
+                && mask_count(validity) == static_cast<std::size_t>(std::ranges::count_if(model,
+                    [](std::optional<std::int64_t> const & value) { return value.has_value(); }))
+                && nullable_sum(vec.span<0>(), validity) == sum;
+        };
+
+        Vec vec;
+        std::vector<std::optional<std::int64_t>> model;
+        for (std::size_t i = 0; i < 1000; ++i)
+        {
+            model.push_back(random_value());
+            vec.push_back(model.back(), static_cast<std::int32_t>(i));
+        }
+        check(vec, model);
+
+        for (std::size_t i = 0; i < 37; ++i)
+        {
+            vec.pop_back();
+            model.pop_back();
+        }
+        check(vec, model);
+
+        vec.resize(637);
+        model.resize(637);
+        check(vec, model);
+        vec.resize(900);
+        model.resize(900);
+        for (std::size_t i = 637; i < 900; ++i)
+        {
+            vec.get<1>(i) = static_cast<std::int32_t>(i);
+        }
+        check(vec, model);
+
+        for (std::size_t n = 0; n < 200; ++n)
+        {
+            std::size_t const i = next_random(state) % model.size();
+            vec.validity<0>()[i / PackedBool::bits].word &= ~(std::uint64_t(1) << (i % PackedBool::bits));
+            model[i].reset();
+        }
+        check(vec, model);
+
+        Vec other;
+        for (std::size_t i = 0; i < 333; ++i)
+        {
+            model.push_back(random_value());
+            other.push_back(model.back(), static_cast<std::int32_t>(900 + i));
+        }
+        vec.append(std::move(other));
+        ok = ok && other.empty();
+        check(vec, model);
+
+        vec.shrink_to_fit();
+        ok = ok && vec.capacity() == vec.size();
+        check(vec, model);
+        for (std::size_t i = model.size(); i < 1300; ++i)
+        {
+            model.push_back(random_value());
+            vec.push_back(model.back(), static_cast<std::int32_t>(i));
         }
+        check(vec, model);
+
+        Vec copy(vec);
+        Vec assigned;
+        assigned = vec;
+        check(copy, model);
+        check(assigned, model);
+        copy.pop_back();
+        assigned.resize(10);
+        check(vec, model);
+
+        std::cout << "Nullable column test: " << (ok ? "passed" : "FAILED") << "\n";
+        return ok;
     }
 
     /*!
-     * Reallocate the data to a new memory allocation of a specific capacity.
+     * Test an 'ArenaString' column against a 'std::vector<std::string>':
+     * push_back, pop_back, resize both ways, append(SOAVector &&),
+     * shrink_to_fit and copies. After every step the strings must match and
+     * the arena must hold exactly their characters.
      *
-     * This will allocate a new chunk of memory, move the elements there,
-     * destruct the original elements and free the original memory allocation.
-     *
-     * @param new_capacity The capacity of the new memory allocation.
+     * @return True if the column always matched.
      */
-    void reallocate(size_type new_capacity)
+    inline bool test_arena_string()
     {
-        assert(new_capacity >= size_);
+        using Vec = SOAVector<ArenaString, std::int32_t>;
+        std::uint64_t state = 0x9E3779B97F4A7C15;
+        bool ok = true;
 
-        // Get the byte offsets for each array as well as the total number of bytes needed.
-        auto const [new_offsets, total_num_bytes] = calculate_array_offsets_and_allocation_size(new_capacity);
+        auto const random_string = [&state]
+        {
+            std::uint64_t const random = next_random(state);
+            return std::string(random % 13, static_cast<char>('a' + (random >> 32) % 26));
+        };
 
-        // Allocate memory aligned to the first type.
-        char * const new_data_ptr = new (std::align_val_t(alignof(value_type<0>))) char[total_num_bytes];
+        // The second column holds the row index, to check that rows stay together.
+        auto const check = [&ok](Vec const & vec, std::vector<std::string> const & model)
+        {
+            bool equal = vec.size() == model.size();
+            std::string bytes;
+            for (std::size_t i = 0; equal && i < model.size(); ++i)
+            {
+                equal = vec.get<0>(i) == model[i] && vec.get<1>(i) == static_cast<std::int32_t>(i);
+                bytes += model[i];
+            }
+            ok = ok && equal && vec.string_bytes<0>() == bytes;
+        };
 
-        std::array<char *, sizeof...(Types)> new_array_ptrs{};
-        for (std::size_t array_index = 0; array_index < new_array_ptrs.size(); ++array_index)
+        Vec vec;
+        std::vector<std::string> model;
+        for (std::size_t i = 0; i < 1000; ++i)
         {
-            new_array_ptrs[array_index] = new_data_ptr + new_offsets[array_index];
+            model.push_back(random_string());
+            vec.push_back(model.back(), static_cast<std::int32_t>(i));
         }
+        check(vec, model);
 
-        if (size_ > 0)
+        for (std::size_t i = 0; i < 37; ++i)
         {
-            // Move existing objects to the new memory allocation.
-            std::size_t type_index = 0;
-            (
-                (
-                    move_elements<Types>(
-                        array_ptrs_[type_index],
-                        array_ptrs_[type_index] + size_ * sizeof(Types),
-                        new_array_ptrs[type_index]),
-                    ++type_index
-                ),
-                ...
-            );
+            vec.pop_back();
+            model.pop_back();
         }
+        check(vec, model);
 
-        if (capacity_ > 0)
+        vec.resize(637);
+        model.resize(637);
+        check(vec, model);
+        vec.resize(900);
+        model.resize(900);
+        for (std::size_t i = 637; i < 900; ++i)
         {
-            delete[] array_ptrs_[0];
+            vec.get<1>(i) = static_cast<std::int32_t>(i);
         }
-        array_ptrs_ = std::move(new_array_ptrs);
-        capacity_ = new_capacity;
+        check(vec, model);
+
+        Vec other;
+        for (std::size_t i = 0; i < 333; ++i)
+        {
+            model.push_back(random_string());
+            other.push_back(model.back(), static_cast<std::int32_t>(900 + i));
+        }
+        vec.append(std::move(other));
+        ok = ok && other.empty() && other.string_bytes<0>().empty();
+        check(vec, model);
+
+        vec.shrink_to_fit();
+        ok = ok && vec.capacity() == vec.size();
+        check(vec, model);
+        for (std::size_t i = model.size(); i < 1300; ++i)
+        {
+            model.push_back(random_string());
+            vec.push_back(model.back(), static_cast<std::int32_t>(i));
+        }
+        check(vec, model);
+
+        Vec copy(vec);
+        Vec assigned;
+        assigned = vec;
+        check(copy, model);
+        check(assigned, model);
+        copy.pop_back();
+        assigned.resize(10);
+        check(vec, model);
+
+        std::cout << "ArenaString column test: " << (ok ? "passed" : "FAILED") << "\n";
+        return ok;
     }
 
     /*!
-     * Calculate the pointer offsets of each array and the total required memory
-     * allocation size for a specific size of the vector.
+     * Compare the throughput of 'SOAVector::scatter_add()' with a naive
+     * 'atomic<I>(i).fetch_add()' per update, for a small contended histogram
+     * and a large sparse one.
      *
-     * @param element_count The number of elements to get the size and
-     *      offsets for.
-     * @return An array with the pointer offsets of each array and the
-     *      required memory allocation size.
+     * @param thread_count The number of threads.
+     * @param update_count The number of updates per thread.
      */
-    constexpr std::pair<std::array<ptrdiff_t, sizeof...(Types)>, size_t>
-    calculate_array_offsets_and_allocation_size(size_type element_count)
+    inline void benchmark_scatter_add(std::size_t thread_count = 4, std::size_t update_count = 1 << 22)
     {
-        // Get the byte sizes and alignments of the types.
-        const auto sizes = std::array{(sizeof(Types) * element_count)...};
-        const auto alignments = std::array{(alignof(Types))...};
+        using Clock = std::chrono::steady_clock;
+        static constexpr std::size_t batch_size = 4096;
 
-        // Calculate the offsets of each array from the 
-        std::array<ptrdiff_t, sizeof...(Types)> offsets{};
-        ptrdiff_t p = alignments[0];
-        for (size_type i = 1; i < sizeof...(Types); ++i)
+        for (std::size_t const bin_count : {std::size_t(256), std::size_t(1) << 22})
         {
-            p = (p + alignments[i] - 1) / alignments[i] * alignments[i];
-            offsets[i] = p;
-            p += sizes[i];
-        }
+            std::vector<std::pair<std::vector<std::size_t>, std::vector<std::int64_t>>> updates;
+            for (std::size_t t = 0; t < thread_count; ++t)
+            {
+                updates.push_back(make_scatter_updates(t, bin_count, update_count));
+            }
 
-        return {offsets, p};
-    }
+            auto const run = [&](auto const & apply)
+            {
+                SOAVector<std::int64_t> histogram(bin_count);
+                Clock::time_point const start = Clock::now();
+                std::vector<std::thread> threads;
+                for (std::size_t t = 0; t < thread_count; ++t)
+                {
+                    threads.emplace_back([&, t] { apply(histogram, updates[t].first, updates[t].second); });
+                }
+                for (std::thread & thread : threads)
+                {
+                    thread.join();
+                }
+                double const seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                benchmark_sink = static_cast<std::uint64_t>(histogram.get<0>(0));
+                return static_cast<double>(thread_count * update_count) / seconds / 1e6;
+            };
 
-    // Member variables:
-    std::array<char *, sizeof...(Types)> array_ptrs_;
-    size_type size_;
-    size_type capacity_;
-    static constexpr float growth_factor = 1.5;
-};
+            double const naive = run([](SOAVector<std::int64_t> & histogram, std::span<std::size_t const> indices,
+                                        std::span<std::int64_t const> values)
+            {
+                for (std::size_t i = 0; i < indices.size(); ++i)
+                {
+                    histogram.atomic<0>(indices[i]).fetch_add(values[i], std::memory_order_relaxed);
+                }
+            });
+            double const combined = run([](SOAVector<std::int64_t> & histogram, std::span<std::size_t const> indices,
+                                           std::span<std::int64_t const> values)
+            {
+                for (std::size_t first = 0; first < indices.size(); first += batch_size)
+                {
+                    std::size_t const count = std::min(batch_size, indices.size() - first);
+                    histogram.scatter_add<0>(indices.subspan(first, count), values.subspan(first, count));
+                }
+            });
+
+            std::cout << "scatter_add with " << thread_count << " threads into " << bin_count << " bins: "
+                      << naive << " M updates/s with naive atomics, " << combined << " M updates/s with scatter_add"
+                      << " in batches of " << batch_size << "\n";
+        }
+    }
+}
 
-int main()
+int main(int argc, char ** argv)
 {
+    std::string_view const mode = argc > 1 ? argv[1] : "";
+    if (mode == "test")
+    {
+        bool ok = self_test::test_snapshot_vector();
+        ok = self_test::test_scatter_add() && ok;
+        ok = self_test::test_parse_csv() && ok;
+        ok = self_test::test_shared_vector_schema() && ok;
+        ok = self_test::test_packed_bool() && ok;
+        ok = self_test::test_nullable() && ok;
+        ok = self_test::test_arena_string() && ok;
+        return ok ? 0 : 1;
+    }
+    if (mode == "bench")
+    {
+        self_test::benchmark_snapshot_vector();
+        self_test::benchmark_scatter_add();
+        return 0;
+    }
+
     using VecType = SOAVector<int16_t, std::string, double>;
     VecType vec;
     vec.push_back(0, "zero", 1.23);